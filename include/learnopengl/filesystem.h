@@ -4,6 +4,13 @@
 #include <string>
 #include <cstdlib>
 #include "root_directory.h" // This is a configuration file generated by CMake.
+#include <rg/MappedFile.h>
+#include <rg/ResourcePack.h>
+
+#include <sys/stat.h>
+
+#include <ctime>
+#include <iostream>
 
 class FileSystem
 {
@@ -17,6 +24,50 @@ public:
     return (*pathBuilder)(path);
   }
 
+  // maps a file from resources.pack, or the loose file when there is no pack or it doesn't have the file.
+  // A loose file modified after the pack was built wins, so edits show up without packing again
+  static bool open(const std::string& path, rg::MappedFile& file)
+  {
+    if (isNewerThanPack(path))
+      return file.Open(path);
+    return openPacked(path, file) || file.Open(path);
+  }
+
+  // the packed copy only
+  static bool openPacked(const std::string& path, rg::MappedFile& file)
+  {
+    return getPack().Find(getRelativePath(path), file);
+  }
+
+  // whole text file, through open()
+  static bool readText(const std::string& path, std::string& text)
+  {
+    rg::MappedFile file;
+    if (!open(path, file))
+      return false;
+    text.assign(reinterpret_cast<const char*>(file.Data()), file.Size());
+    return true;
+  }
+
+  // path as stored in the pack: relative to the root, without a leading "./"
+  static std::string getRelativePath(const std::string& path)
+  {
+    std::string relative = path;
+    const std::string& root = getRoot();
+    if (!root.empty() && relative.compare(0, root.size(), root) == 0 && relative.size() > root.size() && relative[root.size()] == '/')
+      relative = relative.substr(root.size() + 1);
+    while (relative.compare(0, 2, "./") == 0)
+      relative = relative.substr(2);
+    return relative;
+  }
+
+  // mapped on first use, stays mapped until the program exits
+  static const rg::ResourcePack& getPack()
+  {
+    static rg::ResourcePack pack = openPack();
+    return pack;
+  }
+
 private:
   static std::string const & getRoot()
   {
@@ -45,6 +96,29 @@ private:
     return path;
   }
 
+  static bool isNewerThanPack(const std::string& path)
+  {
+    if (!getPack().IsOpen())
+      return false;
+    static time_t packTime = modificationTime(getPath("resources.pack"));
+    return modificationTime(path) > packTime;
+  }
+
+  // 0 if the file doesn't exist
+  static time_t modificationTime(const std::string& path)
+  {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+  }
+
+  static rg::ResourcePack openPack()
+  {
+    rg::ResourcePack pack;
+    if (pack.Open(getPath("resources.pack")))
+      std::cout << "ResourcePack: " << pack.Count() << " files, " << pack.SizeInBytes() / 1024 << " KB mapped" << std::endl;
+    return pack;
+  }
+
 
 };
 
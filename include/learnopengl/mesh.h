@@ -7,8 +7,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/Lod.h>
+#include <rg/VertexFormat.h>
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -41,28 +45,97 @@ public:
     vector<Texture>      textures;
 
     unsigned int VAO;
+    unsigned int indexCount;
+    // GL_UNSIGNED_SHORT whenever the vertex count allows it
+    GLenum indexType = GL_UNSIGNED_INT;
+    // index ranges of the levels of detail inside the index buffer, a single level unless SetLodLevels is called
+    std::vector<rg::LodLevel> lodLevels;
+    // layer of a packed texture array replacing the textures, -1 if the mesh isn't packed
+    int materialSlot = -1;
+    // set through SetTexturePrefix, which hashes the sampler names of the textures once
     std::string glslIdentifierPrefix;
-    // constructor todo: std::move?
+    std::vector<uint64_t> samplerHashes;
+    // layout of the vertices in the VBO, compact meshes need dequantize applied on top of the model matrix
+    rg::VertexLayout layout;
+    bool quantized = false;
+    glm::mat4 dequantize = glm::mat4(1.0f);
+    // constructor, pass the arrays as rvalues to move them in without copying
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
-    :vertices(vertices),
-    indices(indices),
-    textures(textures)
+    :vertices(std::move(vertices)),
+    indices(std::move(indices)),
+    textures(std::move(textures))
     {
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        layout = rg::VertexLayout::Create(rg::VertexFormat::Full, rg::ALL_VERTEX_ATTRIBUTES);
+        if(rg::IndexTypeFor(this->vertices.size()) == GL_UNSIGNED_SHORT)
+        {
+            std::vector<uint16_t> shortIndices = rg::PackIndices16(this->indices.data(), this->indices.size());
+            setupMesh(this->vertices.data(), this->vertices.size(), shortIndices.data(), shortIndices.size(), GL_UNSIGNED_SHORT);
+        }
+        else
+            setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size(), GL_UNSIGNED_INT);
+        SetTexturePrefix(std::string());
+    }
+    // constructor for geometry that lives outside of the mesh (a memory-mapped mesh cache or vertices packed
+    // into another layout). The data is uploaded straight from the given arrays and no CPU-side copy is kept.
+    Mesh(const void *vertexData, size_t vertexCount, const rg::VertexLayout &layout,
+         const void *indexData, size_t indexCount, GLenum indexType, vector<Texture> textures,
+         const glm::mat4 &dequantize = glm::mat4(1.0f))
+    :textures(std::move(textures)),
+    layout(layout),
+    quantized(layout.format == rg::VertexFormat::Compact),
+    dequantize(dequantize)
+    {
+        setupMesh(vertexData, vertexCount, indexData, indexCount, indexType);
+        SetTexturePrefix(std::string());
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // prefix of the sampler names in the shader
+    void SetTexturePrefix(const std::string &prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        samplerHashes = SamplerHashes(textures, prefix);
+    }
+
+    // frees the CPU-side copy of the geometry, the GPU buffers keep working. Returns the number of bytes released.
+    size_t ReleaseGeometry()
+    {
+        size_t bytes = vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+        vector<Vertex>().swap(vertices);
+        vector<unsigned int>().swap(indices);
+        return bytes;
+    }
+
+    // the index data passed to the constructor holds these levels back to back
+    void SetLodLevels(std::vector<rg::LodLevel> levels)
+    {
+        lodLevels = std::move(levels);
+    }
+
+    // render the mesh, coarser levels of detail than the mesh has fall back to its coarsest one
+    void Draw(Shader &shader, size_t lod = 0)
     {
         // bind appropriate textures
+        BindTextures(shader, textures, samplerHashes);
+
+        // draw mesh, the vertex array stays bound so the next draw of this mesh doesn't bind it again
+        rg::GLState::Instance().BindVertexArray(VAO);
+        lod = std::min(lod, lodLevels.size() - 1);
+        size_t firstIndex = rg::LodIndexOffset(lodLevels, lod);
+        glDrawElements(GL_TRIANGLES, lodLevels[lod].indexCount, indexType, (void *) (firstIndex * rg::IndexSize(indexType)));
+    }
+
+    // hash of the sampler name (prefix + type + N) of every texture, built once so drawing builds no strings
+    static std::vector<uint64_t> SamplerHashes(const vector<Texture> &textures, const std::string &glslIdentifierPrefix)
+    {
+        std::vector<uint64_t> hashes;
+        hashes.reserve(textures.size());
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -74,22 +147,21 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            hashes.push_back(Shader::HashName((glslIdentifierPrefix + name + number).c_str()));
         }
+        return hashes;
+    }
 
-
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // binds the textures to consecutive units and points their samplers, hashed by SamplerHashes, at them
+    static void BindTextures(Shader &shader, const vector<Texture> &textures, const std::vector<uint64_t> &samplerHashes)
+    {
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            // set the sampler to the correct texture unit
+            shader.setInt(shader.GetUniform(samplerHashes[i]), i);
+            // and bind the texture to its unit
+            rg::GLState::Instance().BindTexture(i, GL_TEXTURE_2D, textures[i].id);
+        }
     }
 
 private:
@@ -97,42 +169,34 @@ private:
     unsigned int VBO, EBO;
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const void *vertexData, size_t vertexCount, const void *indexData, size_t indexCount, GLenum indexType)
     {
+        this->indexCount = indexCount;
+        this->indexType = indexType;
+        lodLevels.assign(1, rg::LodLevel());
+        lodLevels[0].indexCount = (uint32_t) indexCount;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        rg::GLState::Instance().BindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        // again translates to 3/2 floats which translates to a byte array. Packed layouts are plain byte arrays anyway.
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * layout.stride, vertexData, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * rg::IndexSize(indexType), indexData, GL_STATIC_DRAW);
+
+        // set the vertex attribute pointers (position, normal, texture coords, tangent, bitangent),
+        // attributes that aren't part of the layout stay disabled
+        layout.Apply();
+
+        rg::GLState::Instance().BindVertexArray(0);
     }
 };
 #endif
\ No newline at end of file
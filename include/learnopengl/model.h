@@ -12,6 +12,18 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <rg/Image.h>
+#include <rg/TextureLoader.h>
+#include <rg/TextureRegistry.h>
+#include <rg/TextureArrayPacker.h>
+#include <rg/MeshCache.h>
+#include <rg/MergedGeometry.h>
+#include <rg/MeshCleanup.h>
+#include <rg/MeshOptimizer.h>
+#include <rg/MeshSimplifier.h>
+#include <rg/Lod.h>
+#include <rg/ObjLoader.h>
+#include <rg/Profiler.h>
 
 #include <string>
 #include <fstream>
@@ -23,8 +35,39 @@
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromImage(const rg::Image &image);
+
+// settings for a model that is loaded in two steps, see Model::Import and Model::Upload
+struct ModelOptions {
+    bool gammaCorrection = false;
+    // flip the textures on the y-axis, replaces the global stbi_set_flip_vertically_on_load switch
+    bool flipTextures = false;
+    // vertex layout of the GPU buffers, attributes missing from the mask are stripped (see rg::ActiveAttributeMask)
+    rg::VertexFormat vertexFormat = rg::VertexFormat::Full;
+    unsigned int vertexAttributes = rg::ALL_VERTEX_ATTRIBUTES;
+    // put all meshes into one vertex and index buffer, drawn as base-vertex ranges grouped by material
+    bool mergeMeshes = false;
+    // merge duplicated vertices and drop degenerate and duplicate triangles right after the Assimp import
+    bool cleanupMeshes = true;
+    // read .obj files with the multithreaded rg::ObjLoader, other formats and files it can't parse go through Assimp
+    bool nativeObj = true;
+    // pack the material textures into the packer's array textures instead of creating a texture per image.
+    // modelshader samples only the first texture of a mesh, so only that one is packed
+    rg::TextureArrayPacker *textureArrays = nullptr;
+};
 
-
+// CPU side result of importing one mesh, kept between Import and Upload
+struct MeshData {
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    // what actually gets uploaded, points either into the vectors above or into the mapped mesh cache
+    rg::MeshView view;
+    // vertices converted to a non-native layout, empty if the Vertex array is uploaded as is
+    vector<unsigned char> packedVertices;
+    rg::VertexBounds bounds;
+    // narrowed copy of the indices, filled when the mesh is small enough for 16-bit indices
+    vector<uint16_t> shortIndices;
+};
 
 class Model
 {
@@ -32,46 +75,516 @@ public:
     // model data
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    // used instead of meshes when the model was loaded with ModelOptions::mergeMeshes
+    rg::MergedGeometry merged;
     string directory;
     std::unordered_map<std::string, Texture> loaded_textures_map;
     bool gammaCorrection;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false)
+    : gammaCorrection(gamma), path(path), layout(rg::VertexLayout::Create(rg::VertexFormat::Full, rg::ALL_VERTEX_ATTRIBUTES))
+    {
+        Import();
+        Upload();
+        rg::TextureLoader::Instance().Finish();
+    }
+
+    // constructor for deferred loading, nothing is read until Import() and Upload() are called
+    Model(string const &path, const ModelOptions &options)
+    : gammaCorrection(options.gammaCorrection), path(path), flipTextures(options.flipTextures), mergeMeshes(options.mergeMeshes),
+    cleanupMeshes(options.cleanupMeshes), nativeObj(options.nativeObj), textureArrays(options.textureArrays),
+    layout(rg::VertexLayout::Create(options.vertexFormat, options.vertexAttributes))
+    {
+    }
+
+    // CPU part of loading: parsing, vertex conversion and queueing image decoding. Doesn't use OpenGL,
+    // so it can run on a worker thread while other models are being imported.
+    void Import()
     {
         loadModel(path);
     }
 
+    // GPU part of loading: creates buffers and textures from the imported data. Must run on the context thread.
+    // Texture contents arrive with the next rg::TextureLoader::Finish().
+    void Upload()
+    {
+        rg::ProfileScope profile("model upload", path);
+        // per level the largest error of any mesh, meshes with fewer levels stay at their coarsest
+        for(const MeshData &data : importedMeshes)
+            if(data.view.lods.size() > lodErrors.size())
+                lodErrors.resize(data.view.lods.size(), 0.0f);
+        for(size_t level = 0; level < lodErrors.size(); level++)
+            for(const MeshData &data : importedMeshes)
+                if(!data.view.lods.empty())
+                    lodErrors[level] = std::max(lodErrors[level], data.view.lods[std::min(level, data.view.lods.size() - 1)].error);
+
+        if(mergeMeshes)
+            uploadMerged();
+        for(MeshData &data : importedMeshes)
+        {
+            vector<Texture> textures;
+            if(!textureArrays)
+                for(const auto &texture : data.view.textures)
+                    textures.push_back(loadTexture(texture.second, texture.first));
+            const void *indices = data.shortIndices.empty() ? (const void *) data.view.indices : data.shortIndices.data();
+            GLenum indexType = data.shortIndices.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+            // the imported arrays are moved into the mesh, nothing is copied on the way to the GPU
+            if(!data.packedVertices.empty())
+                meshes.emplace_back(data.packedVertices.data(), data.view.vertexCount, layout, indices, data.view.indexCount, indexType,
+                                    std::move(textures), layout.format == rg::VertexFormat::Compact ? rg::DequantizeMatrix(data.bounds) : glm::mat4(1.0f));
+            else if(data.view.vertices == data.vertices.data())
+                meshes.emplace_back(std::move(data.vertices), std::move(data.indices), std::move(textures));
+            else
+                meshes.emplace_back(data.view.vertices, data.view.vertexCount, layout, indices, data.view.indexCount, indexType, std::move(textures));
+            if(!data.view.lods.empty())
+                meshes.back().SetLodLevels(data.view.lods);
+            meshes.back().materialSlot = packMaterial(data);
+            meshes.back().SetTexturePrefix(glslIdentifierPrefix);
+        }
+        importedMeshes.clear();
+        decodedImages.clear();
+        packedTextureInfo.clear();
+        // release the cache mapping, the geometry already lives in the GPU buffers
+        cacheMapping.Close();
+        uploaded = true;
+    }
+
+    // true once Upload() is done, until then the model draws nothing
+    bool IsUploaded() const { return uploaded; }
+    // uploaded and, for a packed model, its texture arrays built
+    bool IsDrawable() const { return uploaded && (!textureArrays || textureArrays->IsBuilt()); }
+
+    // drops the CPU-side geometry of all meshes once they are uploaded, returns the number of bytes released
+    size_t ReleaseGeometry()
+    {
+        size_t bytes = 0;
+        for(Mesh &mesh : meshes)
+            bytes += mesh.ReleaseGeometry();
+        return bytes;
+    }
+
+    // gives the model's textures back to the registry, which deletes those no other model uses
+    void ReleaseTextures()
+    {
+        for(const auto &texture : loaded_textures_map)
+            rg::TextureRegistry::Instance().Release(texture.second.id);
+        loaded_textures_map.clear();
+    }
+
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        if(!IsDrawable())
+            return;
+        if(merged.IsValid())
+            merged.Draw(shader);
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
 
+    // draws the model with the given model matrix, needed for meshes with quantized positions
+    void Draw(Shader &shader, const glm::mat4 &model)
+    {
+        if(!IsDrawable())
+            return;
+        drawLevel(shader, model, 0);
+    }
+
+    // draws the coarsest level of detail whose error stays below the selector's on-screen threshold
+    void Draw(Shader &shader, const glm::mat4 &model, const rg::LodSelector &selector)
+    {
+        if(!IsDrawable())
+            return;
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        glm::vec3 center = glm::vec3(model * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+        float radius = glm::length(bounds.max - bounds.min) * 0.5f * scale;
+        Draw(shader, model, SelectLod(selector, center, radius, scale));
+    }
+
+    // draws the given level of detail
+    void Draw(Shader &shader, const glm::mat4 &model, size_t lod)
+    {
+        if(!IsDrawable())
+            return;
+        drawLevel(shader, model, lod);
+    }
+
+    // level of detail for a world space bounding sphere computed by the caller, e.g. once per placement
+    size_t SelectLod(const rg::LodSelector &selector, const glm::vec3 &center, float radius, float scale)
+    {
+        lastLod = selector.Select(center, radius, scale, lodErrors);
+        return lastLod;
+    }
+
+    // model space bounds of all meshes, known once the model is imported
+    const rg::VertexBounds &Bounds() const { return bounds; }
+
+    // number of levels of detail and the level the last selecting Draw used
+    size_t LodCount() const { return std::max<size_t>(lodErrors.size(), 1); }
+    size_t LastLod() const { return lastLod; }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
+        glslIdentifierPrefix = prefix;
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.SetTexturePrefix(prefix);
         }
+        merged.SetTexturePrefix(prefix);
     }
 private:
+    // bits of the pipeline options stored in the mesh cache
+    static const uint32_t PIPELINE_CLEANUP = 1;
+    static const uint32_t PIPELINE_NATIVE_OBJ = 2;
+
+    string path;
+    bool flipTextures = false;
+    bool mergeMeshes = false;
+    bool cleanupMeshes = true;
+    bool nativeObj = false;
+    rg::TextureArrayPacker *textureArrays = nullptr;
+    std::string glslIdentifierPrefix;
+    // model space bounds of all meshes and the largest simplification error of every level of detail
+    rg::VertexBounds bounds;
+    vector<float> lodErrors;
+    size_t lastLod = 0;
+    bool uploaded = false;
+    // state between Import and Upload
+    struct TextureInfo {
+        int width = 0, height = 0, channels = 0;
+    };
+    std::unordered_map<std::string, TextureInfo> packedTextureInfo;
+    vector<MeshData> importedMeshes;
+    std::unordered_map<std::string, rg::PendingImage> decodedImages;
+    std::unordered_map<std::string, std::string> importedTextureTypes;
+    rg::MappedFile cacheMapping;
+    rg::VertexLayout layout;
+
+    void drawLevel(Shader &shader, const glm::mat4 &model, size_t lod)
+    {
+        unsigned int boundArray = 0;
+        if(merged.IsValid())
+        {
+            shader.setMat4("model", merged.IsQuantized() ? model * merged.Dequantize() : model);
+            merged.Draw(shader, lod, textureArrays, &boundArray);
+        }
+        bool modelIsSet = false;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if(meshes[i].quantized)
+            {
+                shader.setMat4("model", model * meshes[i].dequantize);
+                modelIsSet = false;
+            }
+            else if(!modelIsSet)
+            {
+                shader.setMat4("model", model);
+                modelIsSet = true;
+            }
+            if(textureArrays)
+                textureArrays->Bind(shader, meshes[i].materialSlot, boundArray);
+            meshes[i].Draw(shader, lod);
+        }
+        if(textureArrays)
+            rg::TextureArrayPacker::Unbind(shader);
+    }
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
-        // read file via ASSIMP
+        const unsigned int importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // warm start: the processed meshes are mapped from the binary cache and uploaded without touching ASSIMP
+        bool native = nativeObj && rg::ObjLoader::IsObjPath(path);
+        rg::MeshCache cache(path, importFlags, (cleanupMeshes ? PIPELINE_CLEANUP : 0) | (native ? PIPELINE_NATIVE_OBJ : 0));
+        if(!loadFromCache(cache))
+        {
+            if(!(native && loadObj(path)) && !loadAssimp(path, importFlags))
+                return;
+            if(cleanupMeshes)
+                cleanup();
+            splitLargeMeshes();
+            // reorder for the GPU and build the levels of detail once, the cache stores the result
+            for(size_t i = 0; i < importedMeshes.size(); i++)
+                optimizeMesh(importedMeshes[i], i);
+
+            vector<rg::MeshView> views;
+            for(MeshData &data : importedMeshes)
+            {
+                data.view.vertices = data.vertices.data();
+                data.view.vertexCount = (uint32_t) data.vertices.size();
+                data.view.indices = data.indices.data();
+                data.view.indexCount = (uint32_t) data.indices.size();
+                views.push_back(data.view);
+            }
+            if(!cache.Store(views))
+                cout << "WARNING::MESH_CACHE:: failed to write " << cache.Path() << endl;
+        }
+
+        for(size_t i = 0; i < importedMeshes.size(); i++)
+        {
+            rg::VertexBounds meshBounds = rg::ComputeBounds(importedMeshes[i].view.vertices, importedMeshes[i].view.vertexCount);
+            bounds.min = i == 0 ? meshBounds.min : glm::min(bounds.min, meshBounds.min);
+            bounds.max = i == 0 ? meshBounds.max : glm::max(bounds.max, meshBounds.max);
+        }
+
+        // convert to the requested vertex layout here, on the importing thread
+        if(!layout.IsNative<Vertex>())
+        {
+            for(MeshData &data : importedMeshes)
+                data.bounds = rg::ComputeBounds(data.view.vertices, data.view.vertexCount);
+            // merged meshes are drawn with one model matrix, so they are quantized relative to the whole model
+            if(mergeMeshes && !importedMeshes.empty())
+            {
+                rg::VertexBounds bounds = importedMeshes[0].bounds;
+                for(const MeshData &data : importedMeshes)
+                {
+                    bounds.min = glm::min(bounds.min, data.bounds.min);
+                    bounds.max = glm::max(bounds.max, data.bounds.max);
+                }
+                for(MeshData &data : importedMeshes)
+                    data.bounds = bounds;
+            }
+            for(MeshData &data : importedMeshes)
+                data.packedVertices = rg::PackVertices(layout, data.view.vertices, data.view.vertexCount, data.bounds);
+        }
+
+        // 16-bit indices for everything that fits, the Vertex path of Upload narrows them itself
+        for(MeshData &data : importedMeshes)
+        {
+            bool keepsVertexArray = data.packedVertices.empty() && data.view.vertices == data.vertices.data() && !mergeMeshes;
+            if(!keepsVertexArray && rg::IndexTypeFor(data.view.vertexCount) == GL_UNSIGNED_SHORT)
+                data.shortIndices = rg::PackIndices16(data.view.indices, data.view.indexCount);
+        }
+
+        // decode every referenced image once on the loader threads, the upload only has to hand the pixels to OpenGL
+        rg::TextureLoader &loader = rg::TextureLoader::Instance();
+        for(const MeshData &data : importedMeshes)
+        {
+            // packed models only need the first texture of every mesh
+            size_t textureCount = textureArrays ? std::min<size_t>(data.view.textures.size(), 1) : data.view.textures.size();
+            for(size_t i = 0; i < textureCount; i++)
+            {
+                const string &texturePath = data.view.textures[i].second;
+                if(decodedImages.count(texturePath) || loaded_textures_map.count(texturePath))
+                    continue;
+                if(textureArrays)
+                {
+                    // the array is chosen by size, which the header tells without decoding
+                    TextureInfo info;
+                    if(!rg::TextureArrayPacker::ReadInfo(directory + '/' + texturePath, info.width, info.height, info.channels))
+                        continue;
+                    packedTextureInfo[texturePath] = info;
+                }
+                decodedImages[texturePath] = loader.Decode(directory + '/' + texturePath, flipTextures);
+            }
+        }
+    }
+
+    // slot of the mesh's first texture in the texture arrays, -1 if the model isn't packed or the mesh has no texture
+    int packMaterial(const MeshData &data)
+    {
+        if(!textureArrays || data.view.textures.empty())
+            return -1;
+        const string &texturePath = data.view.textures[0].second;
+        auto info = packedTextureInfo.find(texturePath);
+        auto decoded = decodedImages.find(texturePath);
+        if(info == packedTextureInfo.end() || decoded == decodedImages.end())
+            return -1;
+        return textureArrays->Add(directory + '/' + texturePath, decoded->second, info->second.width, info->second.height, info->second.channels);
+    }
+
+    // uploads all imported meshes into one merged geometry and consumes them
+    void uploadMerged()
+    {
+        vector<rg::MergedGeometry::Source> sources;
+        for(MeshData &data : importedMeshes)
+        {
+            rg::MergedGeometry::Source source;
+            source.vertices = data.packedVertices.empty() ? (const void *) data.view.vertices : data.packedVertices.data();
+            source.vertexCount = data.view.vertexCount;
+            source.indices = data.shortIndices.empty() ? (const void *) data.view.indices : data.shortIndices.data();
+            source.indexCount = data.view.indexCount;
+            source.indexType = data.shortIndices.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+            source.lods = data.view.lods;
+            source.materialSlot = packMaterial(data);
+            if(!textureArrays)
+                for(const auto &texture : data.view.textures)
+                    source.textures.push_back(loadTexture(texture.second, texture.first));
+            sources.push_back(std::move(source));
+        }
+        bool quantized = layout.format == rg::VertexFormat::Compact && !importedMeshes.empty();
+        merged.Create(layout, sources, quantized ? rg::DequantizeMatrix(importedMeshes[0].bounds) : glm::mat4(1.0f));
+        merged.SetTexturePrefix(glslIdentifierPrefix);
+        importedMeshes.clear();
+    }
+
+    // read file via ASSIMP
+    bool loadAssimp(string const &path, unsigned int importFlags)
+    {
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene;
+        {
+            rg::ProfileScope profile("assimp import", path);
+            scene = importer.ReadFile(path, importFlags);
+        }
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
-
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+        return true;
+    }
+
+    // read an OBJ file with the native parser, the meshes come out the way processMesh builds them
+    bool loadObj(string const &path)
+    {
+        rg::ProfileScope profile("obj parse", path);
+        rg::ObjLoader loader;
+        if(!loader.Load(path))
+        {
+            cout << "ObjLoader: falling back to ASSIMP for " << path << endl;
+            return false;
+        }
+        for(rg::ObjMesh &mesh : loader.meshes)
+        {
+            MeshData data;
+            data.vertices = std::move(mesh.vertices);
+            data.indices = std::move(mesh.indices);
+            // same texture types and order as processMesh
+            if(mesh.material >= 0)
+            {
+                const rg::ObjMaterial &material = loader.materials[mesh.material];
+                addMaterialTexture(data.view.textures, material.diffuseMap, "texture_diffuse");
+                addMaterialTexture(data.view.textures, material.specularMap, "texture_specular");
+                addMaterialTexture(data.view.textures, material.bumpMap, "texture_normal");
+                addMaterialTexture(data.view.textures, material.ambientMap, "texture_height");
+            }
+            profile.AddBytes(data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(unsigned int));
+            importedMeshes.push_back(std::move(data));
+        }
+        return true;
+    }
+
+    bool loadFromCache(const rg::MeshCache &cache)
+    {
+        rg::ProfileScope profile("mesh cache", path);
+        vector<rg::MeshView> views;
+        if(!cache.Load(cacheMapping, views))
+            return false;
+        profile.AddBytes(cacheMapping.Size());
+
+        for(rg::MeshView &view : views)
+        {
+            MeshData data;
+            data.view = std::move(view);
+            importedMeshes.push_back(std::move(data));
+        }
+        return true;
+    }
+
+    // welds the duplicated vertices Assimp produces for OBJ faces and removes triangles that draw nothing
+    void cleanup()
+    {
+        size_t verticesBefore = 0, verticesAfter = 0, trianglesBefore = 0, trianglesAfter = 0;
+        for(MeshData &data : importedMeshes)
+        {
+            verticesBefore += data.vertices.size();
+            trianglesBefore += data.indices.size() / 3;
+            rg::WeldVertices(data.vertices, data.indices);
+            rg::RemoveDegenerateTriangles(data.vertices, data.indices);
+            verticesAfter += data.vertices.size();
+            trianglesAfter += data.indices.size() / 3;
+        }
+        std::ostringstream report;
+        report << "MeshCleanup: " << path.substr(path.find_last_of('/') + 1) << ": vertices " << verticesBefore << " -> " << verticesAfter
+               << ", triangles " << trianglesBefore << " -> " << trianglesAfter << ", saves "
+               << ((verticesBefore - verticesAfter) * sizeof(Vertex) + (trianglesBefore - trianglesAfter) * 3 * sizeof(unsigned int)) / 1024
+               << " KB of vertex and index data\n";
+        cout << report.str() << std::flush;
+    }
+
+    // meshes above the 16-bit index limit are cut into parts that share the material
+    void splitLargeMeshes()
+    {
+        vector<MeshData> split;
+        for(MeshData &data : importedMeshes)
+        {
+            if(data.vertices.size() <= rg::MAX_SHORT_INDEXED_VERTICES)
+            {
+                split.push_back(std::move(data));
+                continue;
+            }
+            auto parts = rg::SplitMesh(data.vertices, data.indices, rg::MAX_SHORT_INDEXED_VERTICES);
+            for(auto &part : parts)
+            {
+                MeshData partData;
+                partData.vertices = std::move(part.first);
+                partData.indices = std::move(part.second);
+                partData.view.textures = data.view.textures;
+                split.push_back(std::move(partData));
+            }
+        }
+        importedMeshes.swap(split);
+    }
+
+    // triangle order for the post-transform cache, then overdraw, then vertex order for fetch locality
+    void optimizeMesh(MeshData &data, size_t meshIndex)
+    {
+        rg::ProfileScope profile("mesh optimize", path);
+        vector<unsigned int> &indices = data.indices;
+        rg::VertexCacheStats before = rg::AnalyzeVertexCache(indices.data(), indices.size(), data.vertices.size());
+        rg::OptimizeVertexCache(indices.data(), indices.size(), data.vertices.size());
+        rg::OptimizeOverdraw(indices.data(), indices.size(), data.vertices.data(), data.vertices.size());
+        rg::OptimizeVertexFetch(data.vertices, indices.data(), indices.size());
+        rg::VertexCacheStats after = rg::AnalyzeVertexCache(indices.data(), indices.size(), data.vertices.size());
+        // one write per line, other models are imported at the same time
+        std::ostringstream report;
+        report.precision(3);
+        report << "MeshOptimizer: " << path.substr(path.find_last_of('/') + 1) << " mesh " << meshIndex
+               << " (" << indices.size() / 3 << " triangles): ACMR " << before.acmr << " -> " << after.acmr
+               << ", ATVR " << before.atvr << " -> " << after.atvr;
+        buildLods(data);
+        report << ", LOD triangles";
+        for(const rg::LodLevel &lod : data.view.lods)
+            report << " " << lod.indexCount / 3;
+        cout << report.str() << "\n" << std::flush;
+    }
+
+    // Simplifies the mesh to 1/2, 1/4 and 1/8 of its triangles, each level from the previous one. The levels are
+    // appended to the index array and share the vertices. Stops early once simplification stops paying off.
+    void buildLods(MeshData &data)
+    {
+        const float ratios[] = {0.5f, 0.25f, 0.125f};
+        vector<unsigned int> &indices = data.indices;
+        rg::VertexBounds meshBounds = rg::ComputeBounds(data.vertices.data(), data.vertices.size());
+        float maxError = glm::length(meshBounds.max - meshBounds.min) * 0.05f;
+
+        data.view.lods.assign(1, rg::LodLevel());
+        data.view.lods[0].indexCount = (uint32_t) indices.size();
+        size_t sourceIndexCount = indices.size();
+        for(float ratio : ratios)
+        {
+            const rg::LodLevel &previous = data.view.lods.back();
+            size_t target = (size_t) (sourceIndexCount * ratio) / 3 * 3;
+            float error = 0.0f;
+            vector<unsigned int> lod = rg::SimplifyMesh(data.vertices.data(), data.vertices.size(),
+                                                        indices.data() + indices.size() - previous.indexCount, previous.indexCount,
+                                                        target, maxError, &error);
+            if(lod.size() > previous.indexCount * 9 / 10)
+                break;
+            rg::OptimizeVertexCache(lod.data(), lod.size(), data.vertices.size());
+            rg::LodLevel level;
+            level.indexCount = (uint32_t) lod.size();
+            // errors add up since every level is built from the one before
+            level.error = previous.error + error;
+            indices.insert(indices.end(), lod.begin(), lod.end());
+            data.view.lods.push_back(level);
+        }
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -83,7 +596,7 @@ private:
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            importedMeshes.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
@@ -93,17 +606,25 @@ private:
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
+        rg::ProfileScope profile("process mesh", path);
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vector<pair<string, string>> &textures = data.view.textures;
 
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
+            // attributes the mesh doesn't have stay zero, vertices are welded and cached byte for byte
             Vertex vertex;
+            vertex.Normal = glm::vec3(0.0f);
+            vertex.Tangent = glm::vec3(0.0f);
+            vertex.Bitangent = glm::vec3(0.0f);
             glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
             // positions
             vector.x = mesh->mVertices[i].x;
@@ -166,61 +687,87 @@ private:
 
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        vector<pair<string, string>> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        vector<pair<string, string>> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        vector<pair<string, string>> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        vector<pair<string, string>> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        profile.AddBytes(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int));
+        // return the extracted mesh data, GL objects are created later in Upload()
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // checks all material textures of a given type and collects them as (type, path) pairs.
+    // the textures themselves are decoded once per model at the end of the import.
+    vector<pair<string, string>> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
-        vector<Texture> textures;
+        vector<pair<string, string>> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            auto it = loaded_textures_map.find(str.C_Str());
-            if(it != loaded_textures_map.end()) {
-                skip = true;
-                textures.push_back(it->second);
-            }
-//            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            addMaterialTexture(textures, str.C_Str(), typeName);
+        }
+        return textures;
+    }
+
+    // adds a (type, path) pair for a texture of the model, empty paths are ignored
+    void addMaterialTexture(vector<pair<string, string>> &textures, const string &path, const string &typeName)
+    {
+        if(path.empty())
+            return;
+        // check if texture was referenced before and if so, reuse it with the type it was first loaded as
+        bool skip = false;
+        auto it = importedTextureTypes.find(path);
+        if(it != importedTextureTypes.end()) {
+            skip = true;
+            textures.emplace_back(it->second, it->first);
+        }
+//        for(unsigned int j = 0; j < textures_loaded.size(); j++)
+//        {
+//            if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
 //            {
-//                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-//                {
-//                    textures.push_back(textures_loaded[j]);
-//                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-//                    break;
-//                }
+//                textures.push_back(textures_loaded[j]);
+//                skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
+//                break;
 //            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-//                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-                loaded_textures_map[str.C_Str()] = texture;
-            }
+//        }
+        if(!skip)
+        {   // if texture hasn't been referenced already, remember it
+            textures.emplace_back(typeName, path);
+//            textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+            importedTextureTypes[path] = typeName;
         }
-        return textures;
+    }
+
+    // loads a single texture relative to the model directory, unless the model already loaded it
+    Texture loadTexture(const string &path, const string &typeName)
+    {
+        auto it = loaded_textures_map.find(path);
+        if(it != loaded_textures_map.end())
+        {
+            Texture texture = it->second;
+            texture.type = typeName;
+            return texture;
+        }
+        // the registry shares the texture with every other model using the same image
+        Texture texture;
+        auto decoded = decodedImages.find(path);
+        texture.id = rg::TextureRegistry::Instance().Acquire(this->directory + '/' + path, flipTextures, rg::TextureParams(),
+                                                             decoded != decodedImages.end() ? &decoded->second : nullptr);
+        texture.type = typeName;
+        texture.path = path;
+        loaded_textures_map[path] = texture;
+        return texture;
     }
 };
 
@@ -230,37 +777,47 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    if (rg::TextureLoader::Instance().IsCompressing())
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        rg::CompressedImage compressed = rg::TextureCache::Load(filename, false);
+        if (compressed.IsValid())
+            return rg::CreateCompressedTexture(compressed);
     }
+
+    rg::Image image = rg::LoadImage(filename, false);
+    if (image.IsValid())
+        return TextureFromImage(image);
     else
-    {
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    return textureID;
+}
+
+unsigned int TextureFromImage(const rg::Image &image)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    GLenum format = GL_RGB;
+    if (image.channels == 1)
+        format = GL_RED;
+    else if (image.channels == 2)
+        format = GL_RG;
+    else if (image.channels == 3)
+        format = GL_RGB;
+    else if (image.channels == 4)
+        format = GL_RGBA;
+
+    rg::GLState::Instance().BindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.get());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     return textureID;
 }
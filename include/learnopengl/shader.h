@@ -4,171 +4,380 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <string>
+#include <utility>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <common.h>
+#include <learnopengl/filesystem.h>
+#include <rg/GLState.h>
+#include <rg/ParallelShaderCompile.h>
+#include <rg/ProgramCache.h>
+#include <rg/Profiler.h>
 class Shader
 {
 public:
+    // location of a uniform, looked up once and then passed to the setters instead of the name
+    struct Uniform
+    {
+        GLint location = -1;
+        bool IsActive() const { return location != -1; }
+    };
+
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly, defines ("#define NAME\n" lines) are inserted after the
+    // #version line of every stage. Compiling and linking are only submitted to the driver, the status is checked
+    // by Finish() once the program is needed, so the driver can work on all programs of a start at once
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr,
+           const std::string &defines = std::string())
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
+        // reading and submitting (or loading the cached binary), the rest is timed by Finish()
+        rg::ProfileScope profile("shader build", vertexPath);
+        mName = vertexPath;
+        // 1. retrieve the vertex/fragment source code from filePath, packed copies are preferred (see FileSystem::open)
         std::string vertexCode;
         std::string fragmentCode;
         std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
+        if(!FileSystem::readText(vertexPath, vertexCode) || !FileSystem::readText(fragmentPath, fragmentCode)
+           || (geometryPath != nullptr && !FileSystem::readText(geometryPath, geometryCode)))
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        if(!defines.empty())
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            vertexCode = insertDefines(vertexCode, defines);
+            fragmentCode = insertDefines(fragmentCode, defines);
+            if(geometryPath != nullptr)
+                geometryCode = insertDefines(geometryCode, defines);
         }
+        profile.AddBytes(vertexCode.size() + fragmentCode.size() + geometryCode.size());
+        // a binary of the same sources linked by the same driver skips compiling, see rg::ProgramCache
+        rg::ProgramCache &cache = rg::ProgramCache::Instance();
+        mCacheKey = cache.Key({vertexCode, fragmentCode, geometryCode});
         // shader Program
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        if(cache.Load(mCacheKey, ID))
+            buildUniformTable();
+        else
+            submit(vertexCode, fragmentCode, geometryPath != nullptr ? &geometryCode : nullptr);
     }
-    // activate the shader
+    // activate the shader, finishing it first if it's still compiling
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        Finish();
+        rg::GLState::Instance().UseProgram(ID);
+    }
+    // true once Finish() won't wait for the driver, see rg::ParallelShaderCompile
+    bool IsReady() const
+    {
+        return mStages.empty() || rg::ParallelShaderCompile::Instance().IsComplete(ID);
+    }
+    // waits for the compiler if it has to, reports errors, stores the binary in the program cache and builds the
+    // uniform table. The setters need the program in use, so use() calls it
+    void Finish()
+    {
+        if(mStages.empty())
+            return;
+        rg::ProfileScope profile("shader finish", mName);
+        static const char *stageNames[] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+        for(size_t i = 0; i < mStages.size(); ++i)
+        {
+            checkCompileErrors(mStages[i], stageNames[i]);
+            // delete the shaders as they're linked into our program now and no longer necessery
+            glDeleteShader(mStages[i]);
+        }
+        mStages.clear();
+        checkCompileErrors(ID, "PROGRAM");
+        rg::ProgramCache::Instance().Store(mCacheKey, ID);
+        buildUniformTable();
+    }
+    // FNV-1a of a uniform name, constexpr so the hashes of literal names can be folded at compile time
+    static constexpr uint64_t HashName(const char *name)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for(; *name; ++name)
+            hash = (hash ^ (unsigned char) *name) * 1099511628211ull;
+        return hash;
+    }
+    // handle for the hot paths, Uniform{-1} (ignored by the setters) if the program has no such active uniform
+    Uniform GetUniform(const char *name) const
+    {
+        return Uniform{location(HashName(name))};
     }
-    // utility uniform functions
+    // same for a name hashed with HashName beforehand, for names that are built at runtime
+    Uniform GetUniform(uint64_t nameHash) const
+    {
+        return Uniform{location(nameHash)};
+    }
+    // utility uniform functions, the names are looked up in the table built after linking, no driver calls
+    // and no allocations for literal names
     // ------------------------------------------------------------------------
+    void setBool(const char *name, bool value) const
+    {
+        glUniform1i(location(HashName(name)), (int)value);
+    }
     void setBool(const std::string &name, bool value) const
-    {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    {
+        setBool(name.c_str(), value);
+    }
+    void setBool(Uniform uniform, bool value) const
+    {
+        glUniform1i(uniform.location, (int)value);
     }
     // ------------------------------------------------------------------------
+    void setInt(const char *name, int value) const
+    {
+        glUniform1i(location(HashName(name)), value);
+    }
     void setInt(const std::string &name, int value) const
-    { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    {
+        setInt(name.c_str(), value);
+    }
+    void setInt(Uniform uniform, int value) const
+    {
+        glUniform1i(uniform.location, value);
     }
     // ------------------------------------------------------------------------
+    void setFloat(const char *name, float value) const
+    {
+        glUniform1f(location(HashName(name)), value);
+    }
     void setFloat(const std::string &name, float value) const
-    { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    {
+        setFloat(name.c_str(), value);
+    }
+    void setFloat(Uniform uniform, float value) const
+    {
+        glUniform1f(uniform.location, value);
     }
     // ------------------------------------------------------------------------
+    void setVec2(const char *name, const glm::vec2 &value) const
+    {
+        glUniform2fv(location(HashName(name)), 1, &value[0]);
+    }
     void setVec2(const std::string &name, const glm::vec2 &value) const
-    { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    {
+        setVec2(name.c_str(), value);
+    }
+    void setVec2(Uniform uniform, const glm::vec2 &value) const
+    {
+        glUniform2fv(uniform.location, 1, &value[0]);
+    }
+    void setVec2(const char *name, float x, float y) const
+    {
+        glUniform2f(location(HashName(name)), x, y);
     }
     void setVec2(const std::string &name, float x, float y) const
-    { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    {
+        setVec2(name.c_str(), x, y);
+    }
+    void setVec2(Uniform uniform, float x, float y) const
+    {
+        glUniform2f(uniform.location, x, y);
     }
     // ------------------------------------------------------------------------
+    void setVec3(const char *name, const glm::vec3 &value) const
+    {
+        glUniform3fv(location(HashName(name)), 1, &value[0]);
+    }
     void setVec3(const std::string &name, const glm::vec3 &value) const
-    { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    {
+        setVec3(name.c_str(), value);
+    }
+    void setVec3(Uniform uniform, const glm::vec3 &value) const
+    {
+        glUniform3fv(uniform.location, 1, &value[0]);
+    }
+    void setVec3(const char *name, float x, float y, float z) const
+    {
+        glUniform3f(location(HashName(name)), x, y, z);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
-    { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    {
+        setVec3(name.c_str(), x, y, z);
+    }
+    void setVec3(Uniform uniform, float x, float y, float z) const
+    {
+        glUniform3f(uniform.location, x, y, z);
     }
     // ------------------------------------------------------------------------
+    void setVec4(const char *name, const glm::vec4 &value) const
+    {
+        glUniform4fv(location(HashName(name)), 1, &value[0]);
+    }
     void setVec4(const std::string &name, const glm::vec4 &value) const
-    { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    {
+        setVec4(name.c_str(), value);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
-    { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    void setVec4(Uniform uniform, const glm::vec4 &value) const
+    {
+        glUniform4fv(uniform.location, 1, &value[0]);
+    }
+    void setVec4(const char *name, float x, float y, float z, float w) const
+    {
+        glUniform4f(location(HashName(name)), x, y, z, w);
+    }
+    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    {
+        setVec4(name.c_str(), x, y, z, w);
+    }
+    void setVec4(Uniform uniform, float x, float y, float z, float w) const
+    {
+        glUniform4f(uniform.location, x, y, z, w);
     }
     // ------------------------------------------------------------------------
+    void setMat2(const char *name, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(location(HashName(name)), 1, GL_FALSE, &mat[0][0]);
+    }
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(name.c_str(), mat);
+    }
+    void setMat2(Uniform uniform, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
+    void setMat3(const char *name, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(location(HashName(name)), 1, GL_FALSE, &mat[0][0]);
+    }
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(name.c_str(), mat);
+    }
+    void setMat3(Uniform uniform, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
+    void setMat4(const char *name, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(location(HashName(name)), 1, GL_FALSE, &mat[0][0]);
+    }
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(name.c_str(), mat);
+    }
+    void setMat4(Uniform uniform, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // name hash -> location, sorted by hash
+    std::vector<std::pair<uint64_t, GLint>> mUniforms;
+    // vertex, fragment and maybe geometry shader of a program Finish() hasn't checked yet
+    std::vector<GLuint> mStages;
+    uint64_t mCacheKey = 0;
+    std::string mName;
+
+    // reflects the active uniforms of the linked program, every element of an array is listed under
+    // "name[i]" and the first one under "name" as well, the way glGetUniformLocation accepts them
+    void buildUniformTable()
+    {
+        mUniforms.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(std::max(maxLength, 1));
+        for(GLint i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint) i, (GLsizei) buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            // uniforms inside blocks have no location
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            if(location == -1)
+                continue;
+            if(size > 1 || (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0))
+            {
+                std::string base = name.substr(0, name.rfind('['));
+                addUniform(base, location);
+                addUniform(base + "[0]", location);
+                for(GLint element = 1; element < size; ++element)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+                }
+            }
+            else
+                addUniform(name, location);
+        }
+        std::sort(mUniforms.begin(), mUniforms.end());
+        for(size_t i = 1; i < mUniforms.size(); ++i)
+            if(mUniforms[i].first == mUniforms[i - 1].first && mUniforms[i].second != mUniforms[i - 1].second)
+                std::cout << "ERROR::SHADER::UNIFORM_NAME_HASH_COLLISION in program " << ID << std::endl;
+    }
+
+    void addUniform(const std::string &name, GLint location)
+    {
+        mUniforms.emplace_back(HashName(name.c_str()), location);
+    }
+
+    GLint location(uint64_t hash) const
+    {
+        auto it = std::lower_bound(mUniforms.begin(), mUniforms.end(), std::make_pair(hash, std::numeric_limits<GLint>::min()));
+        return it != mUniforms.end() && it->first == hash ? it->second : -1;
+    }
+
+    // after the #version line, which has to come first. #line keeps the line numbers of compile errors those of the file
+    static std::string insertDefines(const std::string &source, const std::string &defines)
+    {
+        size_t version = source.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+        if(lineEnd == std::string::npos)
+            return defines + source;
+        long nextLine = std::count(source.begin(), source.begin() + lineEnd + 1, '\n') + 1;
+        return source.substr(0, lineEnd + 1) + defines + "#line " + std::to_string(nextLine) + "\n" + source.substr(lineEnd + 1);
+    }
+
+    // hands the sources to the compiler and links them into ID without asking for the status, which would wait
+    // ------------------------------------------------------------------------
+    void submit(const std::string &vertexCode, const std::string &fragmentCode, const std::string *geometryCode)
+    {
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        // 2. compile shaders
+        unsigned int vertex, fragment;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometry;
+        if(geometryCode != nullptr)
+        {
+            const char * gShaderCode = geometryCode->c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+        }
+        rg::ProgramCache::Instance().PrepareLink(ID);
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        if(geometryCode != nullptr)
+            glAttachShader(ID, geometry);
+        glLinkProgram(ID);
+        mStages = {vertex, fragment};
+        if(geometryCode != nullptr)
+            mStages.push_back(geometry);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,207 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+// Remembers the GL state the renderer changes all the time (program, vertex array, texture bindings per unit,
+// capabilities and the depth function) and drops the calls that would set what is already set. All changes of
+// that state have to go through it; after code it can't see, like the ImGui renderer, call Invalidate().
+// GL thread only
+class GLState
+{
+public:
+    enum Kind {
+        PROGRAM,
+        VERTEX_ARRAY,
+        ACTIVE_TEXTURE,
+        TEXTURE,
+        CAPABILITY,
+        DEPTH_FUNC,
+        KIND_COUNT
+    };
+
+    struct Counters {
+        size_t issued[KIND_COUNT] = {};
+        size_t elided[KIND_COUNT] = {};
+
+        size_t Issued() const { return sum(issued); }
+        size_t Elided() const { return sum(elided); }
+
+    private:
+        static size_t sum(const size_t (&counts)[KIND_COUNT])
+        {
+            size_t total = 0;
+            for (size_t count : counts)
+                total += count;
+            return total;
+        }
+    };
+
+    static const int MAX_UNITS = 32;
+
+    static GLState &Instance()
+    {
+        static GLState state;
+        return state;
+    }
+
+    static const char *KindName(Kind kind)
+    {
+        static const char *names[KIND_COUNT] = {"program", "vertex array", "active texture", "texture", "capability", "depth func"};
+        return names[kind];
+    }
+
+    void UseProgram(GLuint program)
+    {
+        if (change(PROGRAM, mProgram, program))
+            glUseProgram(program);
+    }
+
+    void BindVertexArray(GLuint vertexArray)
+    {
+        if (change(VERTEX_ARRAY, mVertexArray, vertexArray))
+            glBindVertexArray(vertexArray);
+    }
+
+    // unit index, not GL_TEXTURE0 + index
+    void ActiveTexture(GLuint unit)
+    {
+        if (change(ACTIVE_TEXTURE, mActiveUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // on the active unit, also used to bind a texture for uploading to it
+    void BindTexture(GLenum target, GLuint texture)
+    {
+        int slot = targetSlot(target);
+        if (slot < 0 || mActiveUnit >= (GLuint) MAX_UNITS)
+        {
+            ++mFrame.issued[TEXTURE];
+            glBindTexture(target, texture);
+        }
+        else if (change(TEXTURE, mTextures[mActiveUnit][slot], texture))
+            glBindTexture(target, texture);
+    }
+
+    void BindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        int slot = targetSlot(target);
+        // nothing to do, not even switching the active unit
+        if (slot >= 0 && unit < (GLuint) MAX_UNITS && mTextures[unit][slot] == texture)
+        {
+            ++mFrame.elided[TEXTURE];
+            return;
+        }
+        ActiveTexture(unit);
+        BindTexture(target, texture);
+    }
+
+    void Enable(GLenum capability) { SetCapability(capability, true); }
+    void Disable(GLenum capability) { SetCapability(capability, false); }
+
+    void SetCapability(GLenum capability, bool enabled)
+    {
+        GLuint &state = capabilityState(capability);
+        if (!change(CAPABILITY, state, enabled ? 1u : 0u))
+            return;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+
+    void DepthFunc(GLenum function)
+    {
+        if (change(DEPTH_FUNC, mDepthFunc, function))
+            glDepthFunc(function);
+    }
+
+    // before deleting an object: GL unbinds it and may hand out its name again
+    void ForgetTexture(GLuint texture)
+    {
+        for (auto &unit : mTextures)
+            for (GLuint &bound : unit)
+                if (bound == texture)
+                    bound = UNKNOWN;
+    }
+
+    void ForgetVertexArray(GLuint vertexArray)
+    {
+        if (mVertexArray == vertexArray)
+            mVertexArray = UNKNOWN;
+    }
+
+    // the next change of everything is issued
+    void Invalidate()
+    {
+        mProgram = mVertexArray = mActiveUnit = mDepthFunc = UNKNOWN;
+        for (auto &unit : mTextures)
+            for (GLuint &bound : unit)
+                bound = UNKNOWN;
+        for (auto &capability : mCapabilities)
+            capability.second = UNKNOWN;
+    }
+
+    // keeps the counters of the frame that ends for LastFrame() and starts counting the next one
+    void EndFrame()
+    {
+        mLastFrame = mFrame;
+        mFrame = Counters();
+    }
+
+    const Counters &LastFrame() const { return mLastFrame; }
+
+private:
+    enum : GLuint { UNKNOWN = 0xFFFFFFFFu };
+    // texture targets tracked per unit
+    static const int TARGET_COUNT = 3;
+
+    GLState() { Invalidate(); }
+
+    static int targetSlot(GLenum target)
+    {
+        switch (target)
+        {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_CUBE_MAP: return 1;
+            case GL_TEXTURE_2D_ARRAY: return 2;
+            default: return -1;
+        }
+    }
+
+    // true if the call has to be issued, the state is updated then
+    bool change(Kind kind, GLuint &state, GLuint value)
+    {
+        if (state == value)
+        {
+            ++mFrame.elided[kind];
+            return false;
+        }
+        ++mFrame.issued[kind];
+        state = value;
+        return true;
+    }
+
+    GLuint &capabilityState(GLenum capability)
+    {
+        for (auto &entry : mCapabilities)
+            if (entry.first == capability)
+                return entry.second;
+        mCapabilities.emplace_back(capability, UNKNOWN);
+        return mCapabilities.back().second;
+    }
+
+    GLuint mProgram, mVertexArray, mActiveUnit, mDepthFunc;
+    GLuint mTextures[MAX_UNITS][TARGET_COUNT];
+    std::vector<std::pair<GLenum, GLuint>> mCapabilities;
+    Counters mFrame, mLastFrame;
+};
+
+}
+#endif //GLSTATE_H
@@ -0,0 +1,57 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stb_image.h>
+
+#include <learnopengl/filesystem.h>
+#include <rg/MappedFile.h>
+#include <rg/Profiler.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// decoded 8-bit image as returned by stb_image, owns its pixels
+struct Image {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::unique_ptr<unsigned char, void (*)(void *)> pixels{nullptr, stbi_image_free};
+
+    bool IsValid() const { return pixels != nullptr; }
+    size_t SizeInBytes() const { return (size_t) width * height * channels; }
+};
+
+// Decodes an image file. The flip is done here instead of through stbi_set_flip_vertically_on_load,
+// which is a global switch and can't be used while other threads are decoding. The file may come from the resource pack.
+inline Image LoadImage(const std::string &path, bool flipVertically)
+{
+    ProfileScope profile("image decode", path);
+    Image image;
+    MappedFile file;
+    if (!FileSystem::open(path, file))
+        return image;
+    image.pixels.reset(stbi_load_from_memory(file.Data(), (int) file.Size(), &image.width, &image.height, &image.channels, 0));
+    profile.AddBytes(image.SizeInBytes());
+    if (image.pixels && flipVertically)
+    {
+        size_t stride = (size_t) image.width * image.channels;
+        std::vector<unsigned char> row(stride);
+        unsigned char *data = image.pixels.get();
+        for (int y = 0; y < image.height / 2; ++y)
+        {
+            unsigned char *top = data + y * stride;
+            unsigned char *bottom = data + (image.height - 1 - y) * stride;
+            std::memcpy(row.data(), top, stride);
+            std::memcpy(top, bottom, stride);
+            std::memcpy(bottom, row.data(), stride);
+        }
+    }
+    return image;
+}
+
+}
+#endif //IMAGE_H
@@ -0,0 +1,60 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace rg {
+
+// One level of detail of a mesh. The index arrays of all levels are stored back to back, level 0 first,
+// and every level indexes the same vertices.
+struct LodLevel {
+    uint32_t indexCount = 0;
+    // how far the simplified surface may be off the original one, in model space units
+    float error = 0.0f;
+};
+
+// index offsets of the levels inside the concatenated index array
+inline size_t LodIndexOffset(const std::vector<LodLevel> &levels, size_t level)
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < level && i < levels.size(); ++i)
+        offset += levels[i].indexCount;
+    return offset;
+}
+
+// camera parameters for picking a level from the projected screen size of its error
+struct LodSelector {
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    // pixels one unit covers at distance one: viewport height / (2 * tan(fovy / 2))
+    float projectionScale = 1.0f;
+    // tolerated error on screen in pixels
+    float pixelError = 1.0f;
+    // every +1 doubles the tolerated error, negative values prefer finer levels
+    float bias = 0.0f;
+
+    static float ProjectionScale(float fovyRadians, float viewportHeight)
+    {
+        return viewportHeight / (2.0f * std::tan(fovyRadians * 0.5f));
+    }
+
+    // coarsest level whose error stays below the threshold, for an object with the given world space
+    // bounding sphere and model to world scale; levelErrors are ascending and in model space
+    size_t Select(const glm::vec3 &center, float radius, float scale, const std::vector<float> &levelErrors) const
+    {
+        float distance = std::max(glm::length(center - cameraPosition) - radius, 1e-3f);
+        float threshold = pixelError * std::pow(2.0f, bias);
+        size_t level = 0;
+        for (size_t i = 1; i < levelErrors.size(); ++i)
+            if (levelErrors[i] * scale * projectionScale / distance <= threshold)
+                level = i;
+        return level;
+    }
+};
+
+}
+#endif //LOD_H
@@ -0,0 +1,110 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rg {
+
+// 64-bit FNV-1a, used as content hash for cache keys
+inline uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ULL)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// read-only memory mapping of a whole file, the mapping is released together with the object.
+// Can also stand for a range of a mapping owned by someone else, see View()
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path) { Open(path); }
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept
+    : mData(other.mData), mSize(other.mSize), mOwned(other.mOwned)
+    {
+        other.mData = nullptr;
+        other.mSize = 0;
+    }
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+            mData = other.mData;
+            mSize = other.mSize;
+            mOwned = other.mOwned;
+            other.mData = nullptr;
+            other.mSize = 0;
+        }
+        return *this;
+    }
+
+    bool Open(const std::string &path)
+    {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *ptr = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED)
+            {
+                mData = static_cast<const unsigned char *>(ptr);
+                mSize = (size_t) st.st_size;
+            }
+        }
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+        return IsOpen();
+    }
+
+    // bytes that stay valid longer than this object, e.g. a file inside a ResourcePack. Close() won't unmap them
+    void View(const unsigned char *data, size_t size)
+    {
+        Close();
+        mData = data;
+        mSize = size;
+        mOwned = false;
+    }
+
+    void Close()
+    {
+        if (mData && mOwned)
+            munmap(const_cast<unsigned char *>(mData), mSize);
+        mData = nullptr;
+        mSize = 0;
+        mOwned = true;
+    }
+
+    bool IsOpen() const { return mData != nullptr; }
+    const unsigned char *Data() const { return mData; }
+    size_t Size() const { return mSize; }
+    uint64_t Hash() const { return HashBytes(mData, mSize); }
+
+private:
+    const unsigned char *mData = nullptr;
+    size_t mSize = 0;
+    bool mOwned = true;
+};
+
+}
+#endif //MAPPEDFILE_H
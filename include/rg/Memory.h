@@ -0,0 +1,22 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <fstream>
+
+namespace rg {
+
+// resident set size of the process in bytes, read from /proc/self/statm (0 if unavailable)
+inline size_t ResidentMemoryBytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (!(statm >> totalPages >> residentPages))
+        return 0;
+    return residentPages * (size_t) sysconf(_SC_PAGESIZE);
+}
+
+}
+#endif //MEMORY_H
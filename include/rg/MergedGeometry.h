@@ -0,0 +1,185 @@
+#ifndef MERGEDGEOMETRY_H
+#define MERGEDGEOMETRY_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <rg/GLState.h>
+#include <rg/Lod.h>
+#include <rg/TextureArrayPacker.h>
+#include <rg/VertexFormat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+// All meshes of one model in a single VAO with one vertex and one index buffer. Every mesh becomes a range
+// drawn with glDrawElementsBaseVertex, so its indices stay local to the mesh. Ranges are ordered by material
+// and the textures of a material are bound once for all of its ranges.
+class MergedGeometry
+{
+public:
+    // one mesh as handed to Create, the arrays only have to live until Create returns
+    struct Source {
+        const void *vertices = nullptr;
+        size_t vertexCount = 0;
+        const void *indices = nullptr;
+        size_t indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        std::vector<Texture> textures;
+        // levels of detail stored back to back in indices, empty for a single level
+        std::vector<LodLevel> lods;
+        // slot in a TextureArrayPacker used instead of textures, -1 if the mesh isn't packed
+        int materialSlot = -1;
+    };
+
+    // all sources must be in the given layout, quantized layouts must share the dequantize matrix
+    void Create(const VertexLayout &layout, std::vector<Source> &sources, const glm::mat4 &dequantize = glm::mat4(1.0f))
+    {
+        this->layout = layout;
+        this->dequantize = dequantize;
+        quantized = layout.format == VertexFormat::Compact;
+
+        // group the meshes by material, the buffers are filled in group order
+        size_t vertexCount = 0, indexCount = 0;
+        indexType = GL_UNSIGNED_SHORT;
+        std::vector<std::vector<size_t>> members;
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            size_t group = 0;
+            while (group < groups.size() && (groups[group].materialSlot != sources[i].materialSlot
+                                             || !sameTextures(groups[group].textures, sources[i].textures)))
+                ++group;
+            if (group == groups.size())
+            {
+                groups.emplace_back();
+                groups.back().textures = std::move(sources[i].textures);
+                groups.back().materialSlot = sources[i].materialSlot;
+                members.emplace_back();
+            }
+            members[group].push_back(i);
+            vertexCount += sources[i].vertexCount;
+            indexCount += sources[i].indexCount;
+            // indices stay local to their range, so 16-bit works as long as every single mesh fits
+            if (sources[i].indexType != GL_UNSIGNED_SHORT)
+                indexType = GL_UNSIGNED_INT;
+        }
+        const size_t indexSize = IndexSize(indexType);
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        GLState::Instance().BindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * layout.stride, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, NULL, GL_STATIC_DRAW);
+
+        size_t firstVertex = 0, firstIndex = 0;
+        for (size_t group = 0; group < groups.size(); ++group)
+        {
+            for (size_t i : members[group])
+            {
+                const Source &source = sources[i];
+                glBufferSubData(GL_ARRAY_BUFFER, firstVertex * layout.stride, source.vertexCount * layout.stride, source.vertices);
+                const void *indices = source.indices;
+                std::vector<unsigned int> widened;
+                if (source.indexType != indexType)
+                {
+                    const uint16_t *shortIndices = static_cast<const uint16_t *>(source.indices);
+                    widened.assign(shortIndices, shortIndices + source.indexCount);
+                    indices = widened.data();
+                }
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * indexSize, source.indexCount * indexSize, indices);
+                Range range;
+                range.baseVertex = (GLint) firstVertex;
+                if (source.lods.empty())
+                    range.levels.emplace_back((GLsizei) source.indexCount, firstIndex * indexSize);
+                for (size_t level = 0; level < source.lods.size(); ++level)
+                    range.levels.emplace_back((GLsizei) source.lods[level].indexCount,
+                                              (firstIndex + LodIndexOffset(source.lods, level)) * indexSize);
+                groups[group].ranges.push_back(range);
+                firstVertex += source.vertexCount;
+                firstIndex += source.indexCount;
+            }
+        }
+        rangeCount = sources.size();
+        SetTexturePrefix(std::string());
+
+        layout.Apply();
+        GLState::Instance().BindVertexArray(0);
+    }
+
+    bool IsValid() const { return VAO != 0; }
+    GLenum IndexType() const { return indexType; }
+    bool IsQuantized() const { return quantized; }
+    const glm::mat4 &Dequantize() const { return dequantize; }
+    size_t RangeCount() const { return rangeCount; }
+    size_t GroupCount() const { return groups.size(); }
+
+    // prefix of the sampler names in the shader, see Mesh::SetTexturePrefix
+    void SetTexturePrefix(const std::string &prefix)
+    {
+        for (Group &group : groups)
+            group.samplerHashes = Mesh::SamplerHashes(group.textures, prefix);
+    }
+
+    // one VAO bind for the whole model, one texture bind per material or, with packed materials, per array
+    void Draw(Shader &shader, size_t lod = 0, const TextureArrayPacker *packer = nullptr, unsigned int *boundArray = nullptr) const
+    {
+        GLState::Instance().BindVertexArray(VAO);
+        for (const Group &group : groups)
+        {
+            if (packer && boundArray)
+                packer->Bind(shader, group.materialSlot, *boundArray);
+            Mesh::BindTextures(shader, group.textures, group.samplerHashes);
+            for (const Range &range : group.ranges)
+            {
+                // meshes with fewer levels use their coarsest one
+                const std::pair<GLsizei, size_t> &level = range.levels[std::min(lod, range.levels.size() - 1)];
+                glDrawElementsBaseVertex(GL_TRIANGLES, level.first, indexType, (void *) level.second, range.baseVertex);
+            }
+        }
+    }
+
+private:
+    struct Range {
+        // (index count, byte offset) of every level of detail
+        std::vector<std::pair<GLsizei, size_t>> levels;
+        GLint baseVertex = 0;
+    };
+    struct Group {
+        int materialSlot = -1;
+        std::vector<Texture> textures;
+        std::vector<uint64_t> samplerHashes;
+        std::vector<Range> ranges;
+    };
+
+    static bool sameTextures(const std::vector<Texture> &a, const std::vector<Texture> &b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (a[i].id != b[i].id || a[i].type != b[i].type)
+                return false;
+        return true;
+    }
+
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    VertexLayout layout;
+    bool quantized = false;
+    glm::mat4 dequantize = glm::mat4(1.0f);
+    std::vector<Group> groups;
+    size_t rangeCount = 0;
+};
+
+}
+#endif //MERGEDGEOMETRY_H
@@ -0,0 +1,273 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/filesystem.h>
+#include <rg/MappedFile.h>
+#include <rg/Lod.h>
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+// Processed mesh data that doesn't own its arrays. For cached meshes vertex and index pointers point
+// straight into the mapped cache file, for fresh imports into the vectors of the importer.
+struct MeshView {
+    const Vertex *vertices = nullptr;
+    uint32_t vertexCount = 0;
+    // index arrays of all levels of detail back to back, indexCount is their total
+    const unsigned int *indices = nullptr;
+    uint32_t indexCount = 0;
+    std::vector<LodLevel> lods;
+    // (type, path) pairs in the order the material listed them
+    std::vector<std::pair<std::string, std::string>> textures;
+};
+
+// Binary cache of the meshes Assimp produced for one model file.
+// Layout: header, then for every mesh an entry header, its texture strings, its LOD levels and the raw vertex/index arrays,
+// all 4-byte aligned so the arrays can be handed to glBufferData directly from the mapping.
+// The cache is valid only if version, import flags, pipeline options, vertex layout and the hash of the source file all match.
+class MeshCache
+{
+public:
+    // bump whenever the import pipeline produces different data,
+    // version 2: optimized triangle and vertex order, version 3: meshes split to fit 16-bit indices,
+    // version 4: levels of detail, version 5: pipeline options in the header
+    static const uint32_t VERSION = 5;
+
+    // importFlags are the Assimp flags, pipelineOptions any further settings that change the imported data
+    MeshCache(const std::string &sourcePath, unsigned int importFlags, uint32_t pipelineOptions = 0)
+    : mImportFlags(importFlags), mPipelineOptions(pipelineOptions)
+    {
+        MappedFile source;
+        if (FileSystem::open(sourcePath, source))
+            mSourceHash = source.Hash();
+        // one cache file per source path, the file name keeps the model name readable. The path is hashed
+        // relative to the root so a resource pack built in another checkout still has the right names
+        std::string name = sourcePath.substr(sourcePath.find_last_of('/') + 1);
+        std::string relativePath = FileSystem::getRelativePath(sourcePath);
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "-%016llx.rgmesh",
+                      (unsigned long long) HashBytes(relativePath.data(), relativePath.size()));
+        mCachePath = CacheDirectory() + "/" + name + suffix;
+    }
+
+    static std::string CacheDirectory()
+    {
+        return FileSystem::getPath("resources/cache");
+    }
+
+    const std::string &Path() const { return mCachePath; }
+
+    // maps the cache file and fills meshes with views into it, returns false if the cache is missing or stale.
+    // The packed copy is tried first, a loose file written after the pack was built replaces an outdated one
+    bool Load(MappedFile &mapping, std::vector<MeshView> &meshes) const
+    {
+        meshes.clear();
+        if (mSourceHash == 0)
+            return false;
+        if (FileSystem::openPacked(mCachePath, mapping) && parse(mapping, meshes))
+            return true;
+        return mapping.Open(mCachePath) && parse(mapping, meshes);
+    }
+
+    // writes the meshes of a freshly imported model, the file is renamed into place only once complete
+    bool Store(const std::vector<MeshView> &meshes) const
+    {
+        if (mSourceHash == 0)
+            return false;
+        mkdir(CacheDirectory().c_str(), 0755);
+
+        std::string tmpPath = mCachePath + ".tmp";
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "MeshCache: can't write " << tmpPath << std::endl;
+            return false;
+        }
+
+        Header header;
+        std::memcpy(header.magic, magic(), 4);
+        header.version = VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.importFlags = mImportFlags;
+        header.pipelineOptions = mPipelineOptions;
+        header.meshCount = (uint32_t) meshes.size();
+        header.sourceHash = mSourceHash;
+        write(out, &header, sizeof(header));
+
+        for (const MeshView &mesh : meshes)
+        {
+            Entry entry;
+            entry.vertexCount = mesh.vertexCount;
+            entry.indexCount = mesh.indexCount;
+            entry.textureCount = (uint32_t) mesh.textures.size();
+            entry.lodCount = (uint32_t) mesh.lods.size();
+            write(out, &entry, sizeof(entry));
+            for (const auto &texture : mesh.textures)
+            {
+                writeString(out, texture.first);
+                writeString(out, texture.second);
+            }
+            write(out, mesh.lods.data(), mesh.lods.size() * sizeof(LodLevel));
+            write(out, mesh.vertices, mesh.vertexCount * sizeof(Vertex));
+            write(out, mesh.indices, mesh.indexCount * sizeof(unsigned int));
+        }
+        out.close();
+        if (!out || std::rename(tmpPath.c_str(), mCachePath.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t importFlags;
+        uint32_t meshCount;
+        uint32_t pipelineOptions;
+        uint64_t sourceHash;
+    };
+    struct Entry {
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t textureCount;
+        uint32_t lodCount;
+    };
+
+    // bounds checked cursor over the mapped cache file
+    struct Reader {
+        const unsigned char *cur;
+        const unsigned char *end;
+
+        size_t Remaining() const { return (size_t) (end - cur); }
+        template<typename T>
+        bool Read(T &value)
+        {
+            if ((size_t) (end - cur) < sizeof(T))
+                return false;
+            std::memcpy(&value, cur, sizeof(T));
+            cur += sizeof(T);
+            return true;
+        }
+        bool ReadString(std::string &str)
+        {
+            uint32_t length;
+            if (!Read(length) || (size_t) (end - cur) < padded(length))
+                return false;
+            str.assign(reinterpret_cast<const char *>(cur), length);
+            cur += padded(length);
+            return true;
+        }
+        template<typename T>
+        const T *Array(uint32_t count)
+        {
+            size_t bytes = (size_t) count * sizeof(T);
+            if ((size_t) (end - cur) < bytes)
+                return nullptr;
+            const T *array = reinterpret_cast<const T *>(cur);
+            cur += bytes;
+            return array;
+        }
+    };
+
+    // fills meshes with views into a mapped cache file, closes the mapping if the file is stale or damaged
+    bool parse(MappedFile &mapping, std::vector<MeshView> &meshes) const
+    {
+        Reader reader{mapping.Data(), mapping.Data() + mapping.Size()};
+        Header header;
+        if (!reader.Read(header) || std::memcmp(header.magic, magic(), 4) != 0
+            || header.version != VERSION || header.vertexSize != sizeof(Vertex)
+            || header.importFlags != mImportFlags || header.pipelineOptions != mPipelineOptions
+            || header.sourceHash != mSourceHash)
+        {
+            mapping.Close();
+            return false;
+        }
+
+        // every mesh takes at least its entry, a damaged count must not allocate more views than the file can hold
+        if (header.meshCount > reader.Remaining() / sizeof(Entry))
+            return fail(mapping, meshes);
+        meshes.resize(header.meshCount);
+        for (MeshView &mesh : meshes)
+        {
+            Entry entry;
+            if (!reader.Read(entry))
+                return fail(mapping, meshes);
+            for (uint32_t t = 0; t < entry.textureCount; ++t)
+            {
+                std::string type, path;
+                if (!reader.ReadString(type) || !reader.ReadString(path))
+                    return fail(mapping, meshes);
+                mesh.textures.emplace_back(std::move(type), std::move(path));
+            }
+            if (entry.lodCount > reader.Remaining() / sizeof(LodLevel))
+                return fail(mapping, meshes);
+            mesh.lods.resize(entry.lodCount);
+            uint64_t lodIndices = 0;
+            for (LodLevel &lod : mesh.lods)
+            {
+                if (!reader.Read(lod))
+                    return fail(mapping, meshes);
+                lodIndices += lod.indexCount;
+            }
+            // the levels lie back to back in the index array, draws of a level must not read past its end
+            if (!mesh.lods.empty() && lodIndices != entry.indexCount)
+                return fail(mapping, meshes);
+            mesh.vertexCount = entry.vertexCount;
+            mesh.indexCount = entry.indexCount;
+            mesh.vertices = reader.Array<Vertex>(entry.vertexCount);
+            mesh.indices = reader.Array<unsigned int>(entry.indexCount);
+            if (!mesh.vertices || !mesh.indices)
+                return fail(mapping, meshes);
+        }
+        return true;
+    }
+
+    static const char *magic() { return "RGMC"; }
+
+    static size_t padded(size_t length) { return (length + 3) & ~size_t(3); }
+
+    static bool fail(MappedFile &mapping, std::vector<MeshView> &meshes)
+    {
+        std::cout << "MeshCache: corrupted cache file, rebuilding" << std::endl;
+        meshes.clear();
+        mapping.Close();
+        return false;
+    }
+
+    static void write(std::ofstream &out, const void *data, size_t size)
+    {
+        out.write(static_cast<const char *>(data), (std::streamsize) size);
+    }
+
+    static void writeString(std::ofstream &out, const std::string &str)
+    {
+        static const char zeros[4] = {0, 0, 0, 0};
+        uint32_t length = (uint32_t) str.size();
+        write(out, &length, sizeof(length));
+        write(out, str.data(), str.size());
+        write(out, zeros, padded(str.size()) - str.size());
+    }
+
+    unsigned int mImportFlags;
+    uint32_t mPipelineOptions;
+    uint64_t mSourceHash = 0;
+    std::string mCachePath;
+};
+
+}
+#endif //MESHCACHE_H
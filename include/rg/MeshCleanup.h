@@ -0,0 +1,85 @@
+#ifndef MESHCLEANUP_H
+#define MESHCLEANUP_H
+
+#include <glm/glm.hpp>
+
+#include <rg/MappedFile.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rg {
+
+// Merges vertices that are identical in every attribute and remaps the indices to the survivors.
+// Vertices are compared byte for byte, so VertexT must not contain padding. Returns the number of vertices removed.
+template<typename VertexT>
+size_t WeldVertices(std::vector<VertexT> &vertices, std::vector<unsigned int> &indices)
+{
+    struct VertexHash {
+        size_t operator()(const VertexT *v) const { return (size_t) HashBytes(v, sizeof(VertexT)); }
+    };
+    struct VertexEqual {
+        bool operator()(const VertexT *a, const VertexT *b) const { return std::memcmp(a, b, sizeof(VertexT)) == 0; }
+    };
+    std::unordered_map<const VertexT *, unsigned int, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<VertexT> welded;
+    welded.reserve(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+    {
+        auto inserted = unique.emplace(&vertices[v], (unsigned int) welded.size());
+        if (inserted.second)
+            welded.push_back(vertices[v]);
+        remap[v] = inserted.first->second;
+    }
+    for (unsigned int &index : indices)
+        index = remap[index];
+    size_t removed = vertices.size() - welded.size();
+    vertices.swap(welded);
+    return removed;
+}
+
+// Drops triangles that can't produce any pixels (repeated indices or zero area) and triangles that repeat
+// an earlier one with the same winding. Returns the number of triangles removed.
+template<typename VertexT>
+size_t RemoveDegenerateTriangles(const std::vector<VertexT> &vertices, std::vector<unsigned int> &indices)
+{
+    struct Triangle {
+        unsigned int a, b, c;
+        bool operator==(const Triangle &other) const { return a == other.a && b == other.b && c == other.c; }
+    };
+    struct TriangleHash {
+        size_t operator()(const Triangle &t) const { return (size_t) HashBytes(&t, sizeof(t)); }
+    };
+    std::unordered_set<Triangle, TriangleHash> seen;
+    seen.reserve(indices.size() / 3);
+    size_t kept = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        Triangle t{indices[i], indices[i + 1], indices[i + 2]};
+        if (t.a == t.b || t.b == t.c || t.a == t.c)
+            continue;
+        glm::vec3 normal = glm::cross(vertices[t.b].Position - vertices[t.a].Position, vertices[t.c].Position - vertices[t.a].Position);
+        if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f)
+            continue;
+        // a rotation keeps the winding, so every triangle is keyed starting at its smallest index
+        while (t.a > t.b || t.a > t.c)
+            t = Triangle{t.b, t.c, t.a};
+        if (!seen.insert(t).second)
+            continue;
+        indices[kept++] = t.a;
+        indices[kept++] = t.b;
+        indices[kept++] = t.c;
+    }
+    size_t removed = (indices.size() - kept) / 3;
+    indices.resize(kept);
+    return removed;
+}
+
+}
+#endif //MESHCLEANUP_H
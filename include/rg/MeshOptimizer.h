@@ -0,0 +1,311 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+// Import-time optimizations of an indexed triangle list, all of them keep the rendered result identical.
+// Typical order: OptimizeVertexCache, OptimizeOverdraw, then OptimizeVertexFetch.
+
+struct VertexCacheStats {
+    // vertex shader invocations per triangle, 0.5 is the best possible on a regular grid, 3 the worst
+    float acmr = 0.0f;
+    // vertex shader invocations per referenced vertex, 1 is optimal
+    float atvr = 0.0f;
+};
+
+// simulates a FIFO post-transform cache, which is what most hardware approximates
+inline VertexCacheStats AnalyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount,
+                                           unsigned int cacheSize = 16)
+{
+    VertexCacheStats stats;
+    if (indexCount < 3)
+        return stats;
+    // timestamp of the last transform of every vertex, a vertex is cached if fewer than cacheSize misses happened since
+    std::vector<unsigned int> transformedAt(vertexCount, 0);
+    unsigned int misses = 0;
+    size_t used = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int &stamp = transformedAt[indices[i]];
+        if (stamp == 0)
+            ++used;
+        if (stamp == 0 || misses - stamp >= cacheSize)
+            stamp = ++misses;
+    }
+    stats.acmr = (float) misses / (float) (indexCount / 3);
+    stats.atvr = used ? (float) misses / (float) used : 0.0f;
+    return stats;
+}
+
+// Reorders triangles for post-transform cache locality, after Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+// Every vertex gets a score from its position in a simulated LRU cache and from the number of triangles still using it,
+// the next triangle is always the one with the highest sum of its vertex scores.
+inline void OptimizeVertexCache(unsigned int *indices, size_t indexCount, size_t vertexCount)
+{
+    const int cacheSize = 32;
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+
+    auto vertexScore = [](int cachePosition, unsigned int remaining) {
+        if (remaining == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // the last triangle's vertices get a fixed score, so no triangle of it is preferred
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (float) (cachePosition - 3) / (cacheSize - 3), 1.5f);
+        }
+        // boost vertices with few triangles left, finishing them off frees cache slots
+        return score + 2.0f / std::sqrt((float) remaining);
+    };
+
+    // vertex -> triangles adjacency, the first `remaining` entries of every list are the triangles not emitted yet
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++remaining[indices[i]];
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> filled(vertexCount, 0);
+    for (size_t t = 0; t < triangleCount; ++t)
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = indices[t * 3 + k];
+            adjacency[offsets[v] + filled[v]++] = (unsigned int) t;
+        }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        score[v] = vertexScore(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t)
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(cacheSize + 3);
+    nextCache.reserve(cacheSize + 3);
+    size_t best = (size_t) (std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+    size_t scanFrom = 0;
+
+    while (result.size() < triangleCount * 3)
+    {
+        const unsigned int *triangle = indices + best * 3;
+        emitted[best] = true;
+        nextCache.assign(triangle, triangle + 3);
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = triangle[k];
+            result.push_back(v);
+            // move the emitted triangle to the end of the active part of the adjacency list
+            unsigned int *list = &adjacency[offsets[v]];
+            unsigned int *it = std::find(list, list + remaining[v], (unsigned int) best);
+            std::swap(*it, list[remaining[v] - 1]);
+            --remaining[v];
+        }
+        // LRU update: the triangle's vertices go to the front, the rest shifts back
+        for (unsigned int v : cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        for (size_t i = 0; i < nextCache.size(); ++i)
+        {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < (size_t) cacheSize ? (int) i : -1;
+            score[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+        if (nextCache.size() > (size_t) cacheSize)
+            nextCache.resize(cacheSize);
+        cache.swap(nextCache);
+
+        // only triangles touching the cache changed their score
+        float bestScore = -1.0f;
+        best = triangleCount;
+        for (unsigned int v : cache)
+        {
+            for (unsigned int a = 0; a < remaining[v]; ++a)
+            {
+                unsigned int t = adjacency[offsets[v] + a];
+                const unsigned int *other = indices + t * 3;
+                triangleScore[t] = score[other[0]] + score[other[1]] + score[other[2]];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+        // dead end, continue with any triangle that is left
+        if (best == triangleCount)
+        {
+            while (scanFrom < triangleCount && emitted[scanFrom])
+                ++scanFrom;
+            if (scanFrom == triangleCount)
+                break;
+            best = scanFrom;
+        }
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+// Sorts clusters of triangles so that the ones facing outwards are drawn first, which lets the depth test reject
+// more of what is behind them (a simplified version of the cluster sort of Tipsify, Sander et al. 2007).
+// Clusters end wherever the cache optimized order starts over with three cache misses, so the vertex cache
+// efficiency is mostly kept. The sort is dropped if ACMR would grow by more than the given threshold.
+template<typename VertexT>
+void OptimizeOverdraw(unsigned int *indices, size_t indexCount, const VertexT *vertices, size_t vertexCount,
+                      float threshold = 1.05f)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+    const unsigned int cacheSize = 16;
+    float acmrBefore = AnalyzeVertexCache(indices, indexCount, vertexCount, cacheSize).acmr;
+
+    // hard cluster boundaries
+    std::vector<size_t> clusterStart;
+    std::vector<unsigned int> transformedAt(vertexCount, 0);
+    unsigned int misses = 0;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        int triangleMisses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int &stamp = transformedAt[indices[t * 3 + k]];
+            if (stamp == 0 || misses - stamp >= cacheSize)
+            {
+                stamp = ++misses;
+                ++triangleMisses;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+            clusterStart.push_back(t);
+    }
+    if (clusterStart.size() < 2)
+        return;
+    clusterStart.push_back(triangleCount);
+
+    // area weighted centroids and normals of the clusters
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    size_t clusterCount = clusterStart.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f)), normals(clusterCount, glm::vec3(0.0f));
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        float area = 0.0f;
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; ++t)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(normal);
+            centroids[c] += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normals[c] += normal;
+            area += triangleArea;
+        }
+        meshCentroid += centroids[c];
+        meshArea += area;
+        centroids[c] = area > 0.0f ? centroids[c] / area : vertices[indices[clusterStart[c] * 3]].Position;
+        float length = glm::length(normals[c]);
+        normals[c] = length > 0.0f ? normals[c] / length : glm::vec3(0.0f);
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // clusters far out along their normal occlude the rest from most view directions
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        sortKey[c] = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(triangleCount * 3);
+    for (size_t c : order)
+        sorted.insert(sorted.end(), indices + clusterStart[c] * 3, indices + clusterStart[c + 1] * 3);
+    if (AnalyzeVertexCache(sorted.data(), sorted.size(), vertexCount, cacheSize).acmr <= acmrBefore * threshold)
+        std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+// Reorders vertices in the order the index buffer first uses them and drops unreferenced ones, so vertex fetches
+// walk the buffer linearly. Returns the new vertex count.
+template<typename VertexT>
+size_t OptimizeVertexFetch(std::vector<VertexT> &vertices, unsigned int *indices, size_t indexCount)
+{
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<VertexT> reordered;
+    reordered.reserve(vertices.size());
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int &target = remap[indices[i]];
+        if (target == unused)
+        {
+            target = (unsigned int) reordered.size();
+            reordered.push_back(vertices[indices[i]]);
+        }
+        indices[i] = target;
+    }
+    vertices.swap(reordered);
+    return vertices.size();
+}
+
+// Splits a mesh into parts of at most maxVertices vertices each, so every part can use 16-bit indices.
+// Triangles keep their order, vertices on the seams are duplicated into every part using them.
+template<typename VertexT>
+std::vector<std::pair<std::vector<VertexT>, std::vector<unsigned int>>>
+SplitMesh(const std::vector<VertexT> &vertices, const std::vector<unsigned int> &indices, size_t maxVertices)
+{
+    std::vector<std::pair<std::vector<VertexT>, std::vector<unsigned int>>> parts;
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<unsigned int> mapped;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        int added = 0;
+        for (int k = 0; k < 3; ++k)
+            if (remap[indices[i + k]] == unused)
+                ++added;
+        if (parts.empty() || parts.back().first.size() + added > maxVertices)
+        {
+            // start a new part, only the remap entries of the previous one need a reset
+            for (unsigned int v : mapped)
+                remap[v] = unused;
+            mapped.clear();
+            parts.emplace_back();
+        }
+        std::vector<VertexT> &partVertices = parts.back().first;
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = indices[i + k];
+            if (remap[v] == unused)
+            {
+                remap[v] = (unsigned int) partVertices.size();
+                partVertices.push_back(vertices[v]);
+                mapped.push_back(v);
+            }
+            parts.back().second.push_back(remap[v]);
+        }
+    }
+    return parts;
+}
+
+}
+#endif //MESHOPTIMIZER_H
@@ -0,0 +1,286 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Symmetric 4x4 error quadric of Garland and Heckbert, stored as its 10 unique coefficients.
+// Error() is the weighted mean of the squared distances to all planes added so far.
+struct Quadric {
+    double a[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    double weight = 0.0;
+
+    static Quadric FromPlane(const glm::vec3 &normal, float distance, double weight)
+    {
+        double x = normal.x, y = normal.y, z = normal.z, w = distance;
+        Quadric q;
+        double values[10] = {x * x, x * y, x * z, x * w, y * y, y * z, y * w, z * z, z * w, w * w};
+        for (int i = 0; i < 10; ++i)
+            q.a[i] = values[i] * weight;
+        q.weight = weight;
+        return q;
+    }
+
+    void Add(const Quadric &other)
+    {
+        for (int i = 0; i < 10; ++i)
+            a[i] += other.a[i];
+        weight += other.weight;
+    }
+
+    double Error(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double error = a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+                       + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+                       + a[7] * z * z + 2 * a[8] * z + a[9];
+        return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+    }
+};
+
+// Simplifies an indexed triangle list by greedy half-edge collapses ordered by quadric error, until the index
+// count drops to targetIndexCount or the next collapse would move the surface further than maxError.
+// The result indexes the same vertex array. Vertices that only differ in normal or texture coordinates are
+// welded while simplifying, every output corner then picks the closest matching vertex of its position.
+// Open borders are kept in place. resultError receives the largest error (a distance) actually introduced.
+template<typename VertexT>
+std::vector<unsigned int> SimplifyMesh(const VertexT *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount,
+                                       size_t targetIndexCount, float maxError, float *resultError = nullptr)
+{
+    if (resultError)
+        *resultError = 0.0f;
+
+    // weld positions, every vertex points at the first vertex with the same position
+    struct PositionHash {
+        size_t operator()(const glm::vec3 &p) const
+        {
+            // adding zero turns -0 into +0, both compare equal so they need the same hash
+            glm::vec3 normalized = p + glm::vec3(0.0f);
+            uint32_t bits[3];
+            std::memcpy(bits, &normalized, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+    struct PositionEqual {
+        bool operator()(const glm::vec3 &a, const glm::vec3 &b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+    };
+    std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> firstAt;
+    std::vector<unsigned int> position(vertexCount);
+    std::vector<std::vector<unsigned int>> wedges(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        auto inserted = firstAt.emplace(vertices[v].Position, (unsigned int) v);
+        position[v] = inserted.first->second;
+        wedges[position[v]].push_back((unsigned int) v);
+    }
+
+    // triangles on welded positions, corner keeps the original vertex for its attributes
+    struct Triangle {
+        unsigned int v[3];
+        unsigned int corner[3];
+        bool alive;
+    };
+    std::vector<Triangle> triangles;
+    triangles.reserve(indexCount / 3);
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        Triangle t;
+        for (int k = 0; k < 3; ++k)
+        {
+            t.corner[k] = indices[i + k];
+            t.v[k] = position[indices[i + k]];
+        }
+        t.alive = t.v[0] != t.v[1] && t.v[1] != t.v[2] && t.v[0] != t.v[2];
+        if (t.alive)
+            triangles.push_back(t);
+    }
+    size_t aliveCount = triangles.size();
+
+    auto pos = [&](unsigned int v) -> const glm::vec3 & { return vertices[v].Position; };
+    auto normalOf = [&](const unsigned int *v) { return glm::cross(pos(v[1]) - pos(v[0]), pos(v[2]) - pos(v[0])); };
+
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::vector<unsigned int>> adjacency(vertexCount);
+    std::unordered_map<uint64_t, int> edgeUse;
+    auto edgeKey = [](unsigned int a, unsigned int b) {
+        return a < b ? ((uint64_t) a << 32) | b : ((uint64_t) b << 32) | a;
+    };
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        const unsigned int *v = triangles[t].v;
+        glm::vec3 normal = normalOf(v);
+        float area = glm::length(normal);
+        if (area > 0.0f)
+        {
+            normal /= area;
+            Quadric q = Quadric::FromPlane(normal, -glm::dot(normal, pos(v[0])), area);
+            for (int k = 0; k < 3; ++k)
+                quadrics[v[k]].Add(q);
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            adjacency[v[k]].push_back((unsigned int) t);
+            ++edgeUse[edgeKey(v[k], v[(k + 1) % 3])];
+        }
+    }
+    // vertices on open or non-manifold edges never move
+    std::vector<bool> locked(vertexCount, false);
+    for (const auto &edge : edgeUse)
+        if (edge.second != 2)
+            locked[edge.first >> 32] = locked[edge.first & 0xFFFFFFFFu] = true;
+
+    struct Collapse {
+        double cost;
+        unsigned int from, to;
+        unsigned int fromVersion, toVersion;
+        bool operator<(const Collapse &other) const { return cost > other.cost; }
+    };
+    std::vector<unsigned int> version(vertexCount, 0);
+    std::vector<bool> removed(vertexCount, false);
+    std::priority_queue<Collapse> queue;
+    auto push = [&](unsigned int from, unsigned int to) {
+        if (locked[from])
+            return;
+        Quadric q = quadrics[from];
+        q.Add(quadrics[to]);
+        queue.push(Collapse{q.Error(pos(to)), from, to, version[from], version[to]});
+    };
+    for (const Triangle &t : triangles)
+        for (int k = 0; k < 3; ++k)
+        {
+            push(t.v[k], t.v[(k + 1) % 3]);
+            push(t.v[(k + 1) % 3], t.v[k]);
+        }
+
+    const double maxCost = (double) maxError * maxError;
+    std::vector<unsigned int> mark(vertexCount, 0);
+    unsigned int markStamp = 0;
+    double worstCost = 0.0;
+    while (aliveCount * 3 > targetIndexCount && !queue.empty())
+    {
+        Collapse c = queue.top();
+        queue.pop();
+        if (removed[c.from] || removed[c.to] || version[c.from] != c.fromVersion || version[c.to] != c.toVersion)
+            continue;
+        if (c.cost > maxCost)
+            break;
+
+        // link condition: an interior edge shares exactly two neighbours, more would pinch the surface
+        ++markStamp;
+        for (unsigned int t : adjacency[c.from])
+            if (triangles[t].alive)
+                for (unsigned int v : triangles[t].v)
+                    mark[v] = markStamp;
+        int shared = 0;
+        for (unsigned int t : adjacency[c.to])
+            if (triangles[t].alive)
+                for (unsigned int v : triangles[t].v)
+                    if (v != c.from && v != c.to && mark[v] == markStamp)
+                    {
+                        mark[v] = 0;
+                        ++shared;
+                    }
+        if (shared > 2)
+            continue;
+
+        // reject collapses that flip a remaining triangle
+        bool flips = false;
+        for (unsigned int t : adjacency[c.from])
+        {
+            const Triangle &triangle = triangles[t];
+            if (!triangle.alive || triangle.v[0] == c.to || triangle.v[1] == c.to || triangle.v[2] == c.to)
+                continue;
+            unsigned int moved[3];
+            for (int k = 0; k < 3; ++k)
+                moved[k] = triangle.v[k] == c.from ? c.to : triangle.v[k];
+            if (glm::dot(normalOf(triangle.v), normalOf(moved)) <= 0.0f)
+            {
+                flips = true;
+                break;
+            }
+        }
+        if (flips)
+            continue;
+
+        // collapse from onto to
+        for (unsigned int t : adjacency[c.from])
+        {
+            Triangle &triangle = triangles[t];
+            if (!triangle.alive)
+                continue;
+            if (triangle.v[0] == c.to || triangle.v[1] == c.to || triangle.v[2] == c.to)
+            {
+                triangle.alive = false;
+                --aliveCount;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k)
+                if (triangle.v[k] == c.from)
+                    triangle.v[k] = c.to;
+            adjacency[c.to].push_back(t);
+        }
+        removed[c.from] = true;
+        std::vector<unsigned int>().swap(adjacency[c.from]);
+        quadrics[c.to].Add(quadrics[c.from]);
+        ++version[c.to];
+        worstCost = std::max(worstCost, c.cost);
+
+        // drop dead triangles and queue the edges around the merged vertex again, the old ones are stale now
+        std::vector<unsigned int> &around = adjacency[c.to];
+        around.erase(std::remove_if(around.begin(), around.end(), [&](unsigned int t) { return !triangles[t].alive; }), around.end());
+        ++markStamp;
+        for (unsigned int t : around)
+            for (unsigned int v : triangles[t].v)
+                if (v != c.to && mark[v] != markStamp)
+                {
+                    mark[v] = markStamp;
+                    push(v, c.to);
+                    push(c.to, v);
+                }
+    }
+
+    // back to real vertices, every corner takes the wedge of its new position that matches its attributes best
+    std::vector<unsigned int> result;
+    result.reserve(aliveCount * 3);
+    for (const Triangle &triangle : triangles)
+    {
+        if (!triangle.alive)
+            continue;
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int original = triangle.corner[k];
+            unsigned int chosen = original;
+            if (position[original] != triangle.v[k])
+            {
+                float best = -1.0f;
+                for (unsigned int candidate : wedges[triangle.v[k]])
+                {
+                    glm::vec2 uv = vertices[candidate].TexCoords - vertices[original].TexCoords;
+                    glm::vec3 normal = vertices[candidate].Normal - vertices[original].Normal;
+                    float distance = glm::dot(uv, uv) + glm::dot(normal, normal);
+                    if (best < 0.0f || distance < best)
+                    {
+                        best = distance;
+                        chosen = candidate;
+                    }
+                }
+            }
+            result.push_back(chosen);
+        }
+    }
+    if (resultError)
+        *resultError = (float) std::sqrt(worstCost);
+    return result;
+}
+
+}
+#endif //MESHSIMPLIFIER_H
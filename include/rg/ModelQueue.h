@@ -0,0 +1,91 @@
+#ifndef MODELQUEUE_H
+#define MODELQUEUE_H
+
+#include <learnopengl/model.h>
+#include <rg/ThreadPool.h>
+
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace rg {
+
+// Loads models while frames keep rendering. Model::Import() runs on the shared ThreadPool as soon as a model
+// is added, Update() uploads imported models on the GL thread, one per call, so a frame never waits for more
+// than a single upload. Models that aren't uploaded yet draw nothing.
+class ModelQueue
+{
+public:
+    // starts importing the model on a worker thread
+    void Add(Model *model)
+    {
+        if (mEntries.empty())
+            mStart = std::chrono::steady_clock::now();
+        Entry entry;
+        entry.model = model;
+        entry.import = ThreadPool::Shared().Submit([model] { model->Import(); });
+        mEntries.push_back(std::move(entry));
+    }
+
+    // GL thread: uploads the first model whose import is done, in the order the models were added.
+    // Returns the uploaded model or nullptr if none was ready
+    Model *Update()
+    {
+        for (Entry &entry : mEntries)
+        {
+            if (entry.uploaded || entry.import.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                continue;
+            upload(entry);
+            return entry.model;
+        }
+        return nullptr;
+    }
+
+    // GL thread: blocks until the given model is imported and uploads it, the others keep loading
+    void Wait(const Model *model)
+    {
+        for (Entry &entry : mEntries)
+            if (entry.model == model && !entry.uploaded)
+                upload(entry);
+    }
+
+    // GL thread: uploads every model, waiting for the imports that aren't done yet
+    void Finish()
+    {
+        while (!IsDone())
+            if (!Update())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    size_t UploadedCount() const { return mUploaded; }
+    size_t Count() const { return mEntries.size(); }
+    bool IsDone() const { return mUploaded == mEntries.size(); }
+    // from the first Add() until the last upload
+    double LoadSeconds() const { return mSeconds; }
+
+private:
+    struct Entry {
+        Model *model = nullptr;
+        std::future<void> import;
+        bool uploaded = false;
+    };
+
+    void upload(Entry &entry)
+    {
+        entry.import.get();
+        entry.model->Upload();
+        entry.uploaded = true;
+        ++mUploaded;
+        if (IsDone())
+            mSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+    }
+
+    std::vector<Entry> mEntries;
+    size_t mUploaded = 0;
+    std::chrono::steady_clock::time_point mStart;
+    double mSeconds = 0.0;
+};
+
+}
+#endif //MODELQUEUE_H
@@ -0,0 +1,616 @@
+#ifndef OBJLOADER_H
+#define OBJLOADER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/mesh.h>
+#include <rg/MappedFile.h>
+#include <rg/ThreadPool.h>
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// texture maps of an MTL material, paths as written in the file, empty if the map isn't set
+struct ObjMaterial {
+    std::string name;
+    std::string diffuseMap;
+    std::string specularMap;
+    std::string bumpMap;
+    std::string ambientMap;
+};
+
+// all triangles of one material, in the same form Assimp's import produces: fan triangulated, v flipped,
+// smooth normals where the file has none and tangents from the texture coordinates
+struct ObjMesh {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    // index into ObjLoader::materials, -1 for faces without a known material
+    int material = -1;
+};
+
+// Reader for Wavefront OBJ files that writes straight into the Vertex and index arrays of the renderer.
+// The file is memory mapped and cut into chunks at line boundaries, the chunks are parsed on the shared
+// ThreadPool and stitched together with prefix sums of their element counts. Supports v, vt, vn, f, usemtl
+// and mtllib; groups, objects and smoothing groups are ignored, faces are grouped by material only.
+class ObjLoader
+{
+public:
+    std::vector<ObjMaterial> materials;
+    std::vector<ObjMesh> meshes;
+
+    static bool IsObjPath(const std::string &path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || path.size() - dot != 4)
+            return false;
+        std::string extension = path.substr(dot + 1);
+        for (char &c : extension)
+            c = (char) tolower(c);
+        return extension == "obj";
+    }
+
+    // false if the file can't be read or has something this parser doesn't understand, nothing is kept then
+    bool Load(const std::string &path)
+    {
+        materials.clear();
+        meshes.clear();
+        MappedFile file;
+        if (!FileSystem::open(path, file))
+            return false;
+
+        std::vector<Chunk> chunks = split(file.Data(), file.Size());
+        ThreadPool &pool = ThreadPool::Shared();
+        pool.ParallelFor(chunks.size(), [&](size_t i) { parseChunk(chunks[i]); });
+        for (size_t i = 0; i < chunks.size(); ++i)
+            if (chunks[i].failed)
+            {
+                std::cout << "ObjLoader: " << path << ": can't parse \"" << chunks[i].error << "\"" << std::endl;
+                return false;
+            }
+
+        // every chunk learns where its elements start in the whole file
+        size_t positionCount = 0, texCoordCount = 0, normalCount = 0;
+        for (Chunk &chunk : chunks)
+        {
+            chunk.positionBase = positionCount;
+            chunk.texCoordBase = texCoordCount;
+            chunk.normalBase = normalCount;
+            positionCount += chunk.positions.size();
+            texCoordCount += chunk.texCoords.size();
+            normalCount += chunk.normals.size();
+        }
+        positions.resize(positionCount);
+        texCoords.resize(texCoordCount);
+        normals.resize(normalCount);
+        pool.ParallelFor(chunks.size(), [&](size_t i) { resolveChunk(chunks[i]); });
+        for (const Chunk &chunk : chunks)
+            if (chunk.failed)
+            {
+                std::cout << "ObjLoader: " << path << ": face index out of range" << std::endl;
+                return false;
+            }
+
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        for (const Chunk &chunk : chunks)
+            for (const std::string &library : chunk.libraries)
+                loadMaterials(directory + library);
+
+        // face ranges per material in file order, meshes in the order their material first appears
+        std::unordered_map<std::string, size_t> meshByMaterial;
+        std::vector<std::vector<Segment>> segments;
+        std::string material;
+        for (size_t c = 0; c < chunks.size(); ++c)
+        {
+            const Chunk &chunk = chunks[c];
+            size_t faceCount = chunk.faceStarts.size() - 1;
+            for (size_t run = 0; run <= chunk.materials.size(); ++run)
+            {
+                size_t first = run == 0 ? 0 : chunk.materials[run - 1].first;
+                size_t end = run == chunk.materials.size() ? faceCount : chunk.materials[run].first;
+                if (run > 0)
+                    material = chunk.materials[run - 1].second;
+                if (first == end)
+                    continue;
+                auto it = meshByMaterial.find(material);
+                if (it == meshByMaterial.end())
+                {
+                    it = meshByMaterial.emplace(material, meshes.size()).first;
+                    meshes.emplace_back();
+                    meshes.back().material = findMaterial(material);
+                    segments.emplace_back();
+                }
+                segments[it->second].push_back({c, first, end});
+            }
+        }
+        pool.ParallelFor(meshes.size(), [&](size_t i) { buildMesh(meshes[i], chunks, segments[i]); });
+
+        positions.clear();
+        texCoords.clear();
+        normals.clear();
+        return true;
+    }
+
+private:
+    // indices into the file wide arrays, -1 if the corner doesn't reference one
+    struct Corner {
+        int32_t position;
+        int32_t texCoord;
+        int32_t normal;
+        // bits of the indices that were negative, they count back from the chunk's own elements until resolved
+        uint8_t relative;
+    };
+
+    struct Chunk {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+        std::vector<Corner> corners;
+        // first corner of every face, followed by the corner count
+        std::vector<uint32_t> faceStarts;
+        // (first face, name) of every usemtl, faces before the first one keep the material of the previous chunk
+        std::vector<std::pair<size_t, std::string>> materials;
+        std::vector<std::string> libraries;
+        size_t positionBase = 0, texCoordBase = 0, normalBase = 0;
+        bool failed = false;
+        std::string error;
+    };
+
+    struct Segment {
+        size_t chunk;
+        size_t firstFace;
+        size_t endFace;
+    };
+
+    struct CornerHash {
+        size_t operator()(const Corner &c) const
+        {
+            return ((size_t) c.position * 73856093u) ^ ((size_t) c.texCoord * 19349663u) ^ ((size_t) c.normal * 83492791u);
+        }
+    };
+    struct CornerEqual {
+        bool operator()(const Corner &a, const Corner &b) const
+        {
+            return a.position == b.position && a.texCoord == b.texCoord && a.normal == b.normal;
+        }
+    };
+
+    // chunks of at least this size, smaller files aren't worth the threads
+    static const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+
+    static std::vector<Chunk> split(const unsigned char *data, size_t size)
+    {
+        const char *text = reinterpret_cast<const char *>(data);
+        size_t count = std::max<size_t>(1, std::min<size_t>(ThreadPool::Shared().Size() + 1, size / MIN_CHUNK_BYTES));
+        std::vector<Chunk> chunks;
+        const char *begin = text, *end = text + size;
+        for (size_t i = 1; i <= count && begin < end; ++i)
+        {
+            const char *cut = i == count ? end : std::max(begin, text + size / count * i);
+            while (cut < end && cut[-1] != '\n')
+                ++cut;
+            if (cut == begin)
+                continue;
+            chunks.emplace_back();
+            chunks.back().begin = begin;
+            chunks.back().end = cut;
+            begin = cut;
+        }
+        return chunks;
+    }
+
+    static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    static const char *skipBlanks(const char *p, const char *end)
+    {
+        while (p < end && isBlank(*p))
+            ++p;
+        return p;
+    }
+
+    // decimal float with optional sign, fraction and exponent; faster than strtof since it skips the locale
+    // and rounds only once. Returns nullptr if there is no number at p
+    static const char *parseFloat(const char *p, const char *end, float &value)
+    {
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        p = skipBlanks(p, end);
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+        {
+            // digits beyond what fits are dropped, they are far below float precision
+            if (mantissa < 100000000000000000ULL)
+                mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+            else
+                ++exponent;
+        }
+        if (p < end && *p == '.')
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+                if (mantissa < 100000000000000000ULL)
+                {
+                    mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+                    --exponent;
+                }
+        if (digits == 0)
+            return nullptr;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            int e = 0;
+            const char *q = parseInt(p + 1, end, e);
+            if (q)
+            {
+                exponent += e;
+                p = q;
+            }
+        }
+        double result = (double) mantissa;
+        if (exponent < 0)
+            result = -exponent <= 22 ? result / powers[-exponent] : result * std::pow(10.0, exponent);
+        else if (exponent > 0)
+            result = exponent <= 22 ? result * powers[exponent] : result * std::pow(10.0, exponent);
+        value = (float) (negative ? -result : result);
+        return p;
+    }
+
+    static const char *parseInt(const char *p, const char *end, int &value)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        if (p == end || *p < '0' || *p > '9')
+            return nullptr;
+        int64_t result = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+            result = std::min<int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+        value = (int) (negative ? -result : result);
+        return p;
+    }
+
+    // one v/vt/vn reference of a face, 1-based or negative as in the file. Indices are made 0-based, negative
+    // ones relative to the elements of this chunk
+    static const char *parseCorner(const char *p, const char *end, const Chunk &chunk, Corner &corner)
+    {
+        int values[3] = {0, 0, 0};
+        const size_t counts[3] = {chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size()};
+        corner.relative = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (k > 0)
+            {
+                if (p == end || *p != '/')
+                    break;
+                ++p;
+                // v//vn leaves the texture coordinate out
+                if (p < end && *p == '/')
+                    continue;
+            }
+            p = parseInt(p, end, values[k]);
+            if (!p || values[k] == 0)
+                return nullptr;
+        }
+        int32_t *indices[3] = {&corner.position, &corner.texCoord, &corner.normal};
+        for (int k = 0; k < 3; ++k)
+        {
+            if (values[k] > 0)
+                *indices[k] = values[k] - 1;
+            else if (values[k] < 0)
+            {
+                *indices[k] = (int32_t) counts[k] + values[k];
+                corner.relative |= (uint8_t) (1 << k);
+            }
+            else
+                *indices[k] = -1;
+        }
+        return p;
+    }
+
+    // rest of the line without surrounding blanks
+    static std::string restOfLine(const char *p, const char *end)
+    {
+        p = skipBlanks(p, end);
+        const char *last = p;
+        while (last < end && *last != '\n')
+            ++last;
+        while (last > p && isBlank(last[-1]))
+            --last;
+        return std::string(p, last);
+    }
+
+    static bool keyword(const char *p, const char *end, const char *word, const char *&after)
+    {
+        for (; *word; ++word, ++p)
+            if (p == end || *p != *word)
+                return false;
+        if (p < end && !isBlank(*p) && *p != '\n')
+            return false;
+        after = p;
+        return true;
+    }
+
+    static void parseChunk(Chunk &chunk)
+    {
+        const char *p = chunk.begin, *end = chunk.end;
+        // a rough guess from the chunk size keeps the vectors from growing one doubling at a time
+        size_t lines = (size_t) (end - p) / 32;
+        chunk.positions.reserve(lines / 4);
+        chunk.corners.reserve(lines);
+        chunk.faceStarts.reserve(lines / 3);
+        while (p < end)
+        {
+            const char *line = p = skipBlanks(p, end);
+            const char *after = nullptr;
+            bool ok = true;
+            if (keyword(p, end, "v", after))
+            {
+                glm::vec3 v;
+                ok = (p = parseFloat(after, end, v.x)) && (p = parseFloat(p, end, v.y)) && (p = parseFloat(p, end, v.z));
+                chunk.positions.push_back(v);
+            }
+            else if (keyword(p, end, "vt", after))
+            {
+                glm::vec2 t(0.0f);
+                ok = (p = parseFloat(after, end, t.x)) != nullptr;
+                // the second coordinate is optional in the format, the third one is ignored
+                if (ok)
+                {
+                    const char *q = parseFloat(p, end, t.y);
+                    p = q ? q : p;
+                }
+                chunk.texCoords.push_back(t);
+            }
+            else if (keyword(p, end, "vn", after))
+            {
+                glm::vec3 n;
+                ok = (p = parseFloat(after, end, n.x)) && (p = parseFloat(p, end, n.y)) && (p = parseFloat(p, end, n.z));
+                chunk.normals.push_back(n);
+            }
+            else if (keyword(p, end, "f", after))
+            {
+                chunk.faceStarts.push_back((uint32_t) chunk.corners.size());
+                p = skipBlanks(after, end);
+                while (ok && p < end && *p != '\n')
+                {
+                    Corner corner;
+                    ok = (p = parseCorner(p, end, chunk, corner)) != nullptr;
+                    if (ok)
+                    {
+                        chunk.corners.push_back(corner);
+                        p = skipBlanks(p, end);
+                    }
+                }
+            }
+            else if (keyword(p, end, "usemtl", after))
+                chunk.materials.emplace_back(chunk.faceStarts.size(), restOfLine(after, end));
+            else if (keyword(p, end, "mtllib", after))
+                chunk.libraries.push_back(restOfLine(after, end));
+            if (!ok)
+            {
+                chunk.failed = true;
+                chunk.error = restOfLine(line, end);
+                return;
+            }
+            // comments, groups, objects, smoothing groups and anything after the values on a line are skipped
+            while (p < end && *p++ != '\n')
+                ;
+        }
+        chunk.faceStarts.push_back((uint32_t) chunk.corners.size());
+    }
+
+    // copies the chunk's elements to their place in the file wide arrays and makes its indices absolute
+    void resolveChunk(Chunk &chunk)
+    {
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase);
+        std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordBase);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase);
+        const size_t bases[3] = {chunk.positionBase, chunk.texCoordBase, chunk.normalBase};
+        const size_t sizes[3] = {positions.size(), texCoords.size(), normals.size()};
+        for (Corner &corner : chunk.corners)
+        {
+            int32_t *indices[3] = {&corner.position, &corner.texCoord, &corner.normal};
+            for (int k = 0; k < 3; ++k)
+            {
+                if (corner.relative & (1 << k))
+                    *indices[k] += (int32_t) bases[k];
+                else if (*indices[k] < 0)
+                    continue;
+                if (*indices[k] < 0 || (size_t) *indices[k] >= sizes[k])
+                    chunk.failed = true;
+            }
+            if (corner.position < 0)
+                chunk.failed = true;
+        }
+        chunk.positions = std::vector<glm::vec3>();
+        chunk.texCoords = std::vector<glm::vec2>();
+        chunk.normals = std::vector<glm::vec3>();
+    }
+
+    void buildMesh(ObjMesh &mesh, const std::vector<Chunk> &chunks, const std::vector<Segment> &segments) const
+    {
+        std::unordered_map<Corner, unsigned int, CornerHash, CornerEqual> vertexByCorner;
+        // position index of every vertex, for smoothing normals across vertices that differ in other attributes
+        std::vector<int32_t> vertexPositions;
+        bool missingNormals = false, hasTexCoords = false;
+        for (const Segment &segment : segments)
+        {
+            const Chunk &chunk = chunks[segment.chunk];
+            for (size_t face = segment.firstFace; face < segment.endFace; ++face)
+            {
+                uint32_t first = chunk.faceStarts[face], count = chunk.faceStarts[face + 1] - first;
+                unsigned int fan[2] = {0, 0};
+                for (uint32_t k = 0; k < count; ++k)
+                {
+                    const Corner &corner = chunk.corners[first + k];
+                    auto inserted = vertexByCorner.emplace(corner, (unsigned int) mesh.vertices.size());
+                    if (inserted.second)
+                    {
+                        Vertex vertex;
+                        vertex.Position = positions[corner.position];
+                        vertex.Normal = corner.normal >= 0 ? normals[corner.normal] : glm::vec3(0.0f);
+                        vertex.TexCoords = glm::vec2(0.0f);
+                        if (corner.texCoord >= 0)
+                        {
+                            // same orientation as aiProcess_FlipUVs
+                            vertex.TexCoords = glm::vec2(texCoords[corner.texCoord].x, 1.0f - texCoords[corner.texCoord].y);
+                            hasTexCoords = true;
+                        }
+                        vertex.Tangent = glm::vec3(0.0f);
+                        vertex.Bitangent = glm::vec3(0.0f);
+                        missingNormals |= corner.normal < 0;
+                        mesh.vertices.push_back(vertex);
+                        vertexPositions.push_back(corner.position);
+                    }
+                    unsigned int index = inserted.first->second;
+                    // polygons become a fan around their first corner
+                    if (k >= 2)
+                    {
+                        mesh.indices.push_back(fan[0]);
+                        mesh.indices.push_back(fan[1]);
+                        mesh.indices.push_back(index);
+                    }
+                    fan[k == 0 ? 0 : 1] = index;
+                }
+            }
+        }
+        if (missingNormals)
+            smoothNormals(mesh, vertexPositions);
+        if (hasTexCoords)
+            computeTangents(mesh);
+    }
+
+    // area weighted face normals summed per position, for the vertices the file gives no normal
+    static void smoothNormals(ObjMesh &mesh, const std::vector<int32_t> &vertexPositions)
+    {
+        std::unordered_map<int32_t, glm::vec3> sums;
+        std::vector<Vertex> &v = mesh.vertices;
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+            glm::vec3 normal = glm::cross(v[b].Position - v[a].Position, v[c].Position - v[a].Position);
+            for (unsigned int corner : {a, b, c})
+                if (v[corner].Normal == glm::vec3(0.0f))
+                    sums[vertexPositions[corner]] += normal;
+        }
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            auto sum = sums.find(vertexPositions[i]);
+            if (v[i].Normal == glm::vec3(0.0f) && sum != sums.end() && glm::length(sum->second) > 0.0f)
+                v[i].Normal = glm::normalize(sum->second);
+        }
+    }
+
+    // per triangle tangent frame from the texture coordinates, summed per vertex and made orthogonal to the normal
+    static void computeTangents(ObjMesh &mesh)
+    {
+        std::vector<Vertex> &v = mesh.vertices;
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+            glm::vec3 e1 = v[b].Position - v[a].Position, e2 = v[c].Position - v[a].Position;
+            glm::vec2 d1 = v[b].TexCoords - v[a].TexCoords, d2 = v[c].TexCoords - v[a].TexCoords;
+            float det = d1.x * d2.y - d2.x * d1.y;
+            if (std::fabs(det) < 1e-12f)
+                continue;
+            float r = 1.0f / det;
+            glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) * r;
+            glm::vec3 bitangent = (e2 * d1.x - e1 * d2.x) * r;
+            for (unsigned int corner : {a, b, c})
+            {
+                v[corner].Tangent += tangent;
+                v[corner].Bitangent += bitangent;
+            }
+        }
+        for (Vertex &vertex : v)
+        {
+            glm::vec3 tangent = vertex.Tangent - vertex.Normal * glm::dot(vertex.Normal, vertex.Tangent);
+            vertex.Tangent = glm::length(tangent) > 0.0f ? glm::normalize(tangent) : glm::vec3(0.0f);
+            vertex.Bitangent = glm::length(vertex.Bitangent) > 0.0f ? glm::normalize(vertex.Bitangent) : glm::vec3(0.0f);
+        }
+    }
+
+    int findMaterial(const std::string &name) const
+    {
+        for (size_t i = 0; i < materials.size(); ++i)
+            if (materials[i].name == name)
+                return (int) i;
+        return -1;
+    }
+
+    // the map keywords the Assimp import reads for the four texture types of the renderer
+    void loadMaterials(const std::string &path)
+    {
+        std::string text;
+        if (!FileSystem::readText(path, text))
+        {
+            std::cout << "ObjLoader: can't read material library " << path << std::endl;
+            return;
+        }
+        std::istringstream in(text);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            const char *p = skipBlanks(line.data(), line.data() + line.size()), *end = line.data() + line.size();
+            const char *after = nullptr;
+            if (keyword(p, end, "newmtl", after))
+            {
+                materials.emplace_back();
+                materials.back().name = restOfLine(after, end);
+                continue;
+            }
+            if (materials.empty())
+                continue;
+            ObjMaterial &material = materials.back();
+            std::string *map = keyword(p, end, "map_Kd", after) ? &material.diffuseMap
+                             : keyword(p, end, "map_Ks", after) ? &material.specularMap
+                             : keyword(p, end, "map_Ka", after) ? &material.ambientMap
+                             : keyword(p, end, "map_bump", after) || keyword(p, end, "map_Bump", after) || keyword(p, end, "bump", after)
+                               ? &material.bumpMap : nullptr;
+            if (map)
+                *map = mapPath(after, end);
+        }
+    }
+
+    // file name of a map statement: options like "-bm 0.5" come first, the rest of the line is the name,
+    // which may contain spaces
+    static std::string mapPath(const char *p, const char *end)
+    {
+        for (p = skipBlanks(p, end); p < end && *p == '-';)
+        {
+            while (p < end && !isBlank(*p))
+                ++p;
+            // option values are numbers or on/off
+            for (p = skipBlanks(p, end); p < end; p = skipBlanks(p, end))
+            {
+                float number;
+                const char *q = parseFloat(p, end, number);
+                if (q && (q == end || isBlank(*q)))
+                    p = q;
+                else if (keyword(p, end, "on", q) || keyword(p, end, "off", q))
+                    p = q;
+                else
+                    break;
+            }
+        }
+        return restOfLine(p, end);
+    }
+};
+
+}
+#endif //OBJLOADER_H
@@ -0,0 +1,79 @@
+#ifndef PARALLELSHADERCOMPILE_H
+#define PARALLELSHADERCOMPILE_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// KHR/ARB_parallel_shader_compile, glad is generated for 3.3 core without them
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace rg {
+
+inline bool HasGLExtension(const char *extension)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char *name = (const char *) glGetStringi(GL_EXTENSIONS, i);
+        if (name && std::strcmp(name, extension) == 0)
+            return true;
+    }
+    return false;
+}
+
+// With KHR_parallel_shader_compile (or the ARB version) the driver compiles and links on threads of its own and
+// the status of a program can be polled without waiting for it. Without it the first status query waits, so a
+// Shader only asks once the program is needed either way. GL thread only
+class ParallelShaderCompile
+{
+public:
+    static ParallelShaderCompile &Instance()
+    {
+        static ParallelShaderCompile parallel;
+        return parallel;
+    }
+
+    // after the GL functions are loaded, lets the driver pick the number of compiler threads
+    bool Init(GLADloadproc load)
+    {
+        MaxShaderCompilerThreadsProc maxThreads = nullptr;
+        if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+            maxThreads = (MaxShaderCompilerThreadsProc) load("glMaxShaderCompilerThreadsKHR");
+        else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+            maxThreads = (MaxShaderCompilerThreadsProc) load("glMaxShaderCompilerThreadsARB");
+        mEnabled = maxThreads != nullptr;
+        if (mEnabled)
+            maxThreads(0xFFFFFFFFu);
+        return mEnabled;
+    }
+
+    bool IsEnabled() const { return mEnabled; }
+
+    // false while the driver still works on the program, always false without the extension since asking would
+    // wait for it
+    bool IsComplete(GLuint program) const
+    {
+        if (!mEnabled)
+            return false;
+        GLint complete = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+private:
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+    ParallelShaderCompile() = default;
+
+    bool mEnabled = false;
+};
+
+}
+#endif //PARALLELSHADERCOMPILE_H
@@ -0,0 +1,214 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Collects the wall time, CPU time and bytes of the loading stages (shader builds, imports, image decodes,
+// texture uploads, ...) from every thread. PrintReport() sums them up per asset, WriteChromeTrace() writes
+// every single event for chrome://tracing or Perfetto. Recording stops with SetEnabled(false).
+class Profiler
+{
+public:
+    struct Event {
+        std::string stage;
+        std::string asset;
+        // small number per thread, 0 for the thread that created the profiler
+        unsigned int thread = 0;
+        // microseconds since the profiler was created
+        double startUs = 0.0;
+        double wallUs = 0.0;
+        double cpuUs = 0.0;
+        size_t bytes = 0;
+    };
+
+    // the first call starts the clock, call it at the start of main()
+    static Profiler &Instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void SetEnabled(bool enabled) { mEnabled = enabled; }
+    bool IsEnabled() const { return mEnabled; }
+
+    double NowUs() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - mEpoch).count();
+    }
+
+    // CPU time the calling thread has used so far
+    static double ThreadCpuUs()
+    {
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return time.tv_sec * 1e6 + time.tv_nsec * 1e-3;
+    }
+
+    // any thread
+    void Record(Event event)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto thread = mThreads.emplace(std::this_thread::get_id(), (unsigned int) mThreads.size()).first;
+        event.thread = thread->second;
+        mEvents.push_back(std::move(event));
+    }
+
+    // one line per stage and asset, slowest first, followed by the totals per stage
+    void PrintReport(std::ostream &out = std::cout) const
+    {
+        struct Sum {
+            double wallUs = 0.0, cpuUs = 0.0;
+            size_t bytes = 0, count = 0;
+            void Add(const Event &event)
+            {
+                wallUs += event.wallUs;
+                cpuUs += event.cpuUs;
+                bytes += event.bytes;
+                ++count;
+            }
+        };
+        std::map<std::pair<std::string, std::string>, Sum> assets;
+        std::map<std::string, Sum> stages;
+        double endUs = 0.0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (const Event &event : mEvents)
+            {
+                assets[std::make_pair(event.stage, event.asset)].Add(event);
+                stages[event.stage].Add(event);
+                endUs = std::max(endUs, event.startUs + event.wallUs);
+            }
+        }
+        std::vector<std::pair<std::pair<std::string, std::string>, Sum>> rows(assets.begin(), assets.end());
+        std::sort(rows.begin(), rows.end(), [](const decltype(rows)::value_type &a, const decltype(rows)::value_type &b) {
+            return a.second.wallUs > b.second.wallUs;
+        });
+
+        out << std::fixed << std::setprecision(2);
+        out << "Startup profile, " << endUs / 1000.0 << " ms from the first to the last recorded event:\n";
+        out << "      wall ms     cpu ms       KB  calls  stage / asset\n";
+        for (const auto &row : rows)
+            printRow(out, row.second.wallUs, row.second.cpuUs, row.second.bytes, row.second.count,
+                     row.first.first + (row.first.second.empty() ? "" : "  " + row.first.second));
+        out << "  per stage (work on the worker threads overlaps):\n";
+        for (const auto &stage : stages)
+            printRow(out, stage.second.wallUs, stage.second.cpuUs, stage.second.bytes, stage.second.count, stage.first);
+        out.flush();
+        out.unsetf(std::ios::floatfield);
+    }
+
+    // Trace Event Format, one complete ("X") event per recorded scope
+    bool WriteChromeTrace(const std::string &path) const
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "Profiler: can't write " << path << std::endl;
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for (const auto &thread : mThreads)
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.second << ",\"args\":{\"name\":\""
+                << (thread.second == 0 ? std::string("main") : "worker " + std::to_string(thread.second)) << "\"}},\n";
+        for (size_t i = 0; i < mEvents.size(); ++i)
+        {
+            const Event &event = mEvents[i];
+            std::string name = event.asset.empty() ? event.stage : event.stage + " " + event.asset.substr(event.asset.find_last_of('/') + 1);
+            out << "{\"name\":\"" << escape(name) << "\",\"cat\":\"" << escape(event.stage) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << event.thread << ",\"ts\":" << event.startUs << ",\"dur\":" << event.wallUs << ",\"args\":{\"asset\":\""
+                << escape(event.asset) << "\",\"cpu_ms\":" << event.cpuUs / 1000.0 << ",\"bytes\":" << event.bytes << "}}"
+                << (i + 1 < mEvents.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+        return (bool) out;
+    }
+
+private:
+    Profiler() : mEpoch(std::chrono::steady_clock::now())
+    {
+        mThreads.emplace(std::this_thread::get_id(), 0);
+    }
+
+    static void printRow(std::ostream &out, double wallUs, double cpuUs, size_t bytes, size_t count, const std::string &name)
+    {
+        out << "  " << std::setw(11) << wallUs / 1000.0 << std::setw(11) << cpuUs / 1000.0 << std::setw(9) << bytes / 1024
+            << std::setw(7) << count << "  " << name << "\n";
+    }
+
+    static std::string escape(const std::string &s)
+    {
+        std::string escaped;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if ((unsigned char) c >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+
+    std::chrono::steady_clock::time_point mEpoch;
+    std::atomic<bool> mEnabled{true};
+    std::vector<Event> mEvents;
+    std::unordered_map<std::thread::id, unsigned int> mThreads;
+    mutable std::mutex mMutex;
+};
+
+// Records the enclosing block as one event of the given stage. Costs nothing but a flag check when the
+// profiler is disabled
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *stage, const std::string &asset = std::string())
+    : mActive(Profiler::Instance().IsEnabled())
+    {
+        if (!mActive)
+            return;
+        mEvent.stage = stage;
+        mEvent.asset = asset;
+        mEvent.startUs = Profiler::Instance().NowUs();
+        mCpuStartUs = Profiler::ThreadCpuUs();
+    }
+
+    ~ProfileScope()
+    {
+        if (!mActive)
+            return;
+        mEvent.wallUs = Profiler::Instance().NowUs() - mEvent.startUs;
+        mEvent.cpuUs = Profiler::ThreadCpuUs() - mCpuStartUs;
+        Profiler::Instance().Record(std::move(mEvent));
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+    // bytes read, decoded or uploaded by the stage
+    void AddBytes(size_t bytes) { mEvent.bytes += bytes; }
+
+private:
+    bool mActive;
+    Profiler::Event mEvent;
+    double mCpuStartUs = 0.0;
+};
+
+}
+#endif //PROFILER_H
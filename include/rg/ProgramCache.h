@@ -0,0 +1,197 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/filesystem.h>
+#include <rg/MappedFile.h>
+#include <rg/ParallelShaderCompile.h>
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// GL 4.1 / ARB_get_program_binary, glad is generated for 3.3 core without them
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace rg {
+
+// Linked programs are stored with glGetProgramBinary in resources/cache/programs and loaded with glProgramBinary
+// on the next start. The key covers the final sources (so the defines prepended to them as well) and the
+// driver's vendor, renderer and version strings. A binary the driver refuses, which it may do after any
+// update, is compiled again and replaced. GL thread only
+class ProgramCache
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    static ProgramCache &Instance()
+    {
+        static ProgramCache cache;
+        return cache;
+    }
+
+    static std::string CacheDirectory()
+    {
+        return FileSystem::getPath("resources/cache/programs");
+    }
+
+    // after the GL functions are loaded: stays disabled if the driver can't return program binaries
+    bool Init(GLADloadproc load)
+    {
+        mGetProgramBinary = (GetProgramBinaryProc) load("glGetProgramBinary");
+        mProgramBinary = (ProgramBinaryProc) load("glProgramBinary");
+        mProgramParameteri = (ProgramParameteriProc) load("glProgramParameteri");
+        GLint formats = 0;
+        if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1) || HasGLExtension("GL_ARB_get_program_binary"))
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        mEnabled = formats > 0 && mGetProgramBinary && mProgramBinary && mProgramParameteri;
+        std::string driver;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        {
+            const char *value = (const char *) glGetString(name);
+            driver += value ? value : "";
+            driver += '\n';
+        }
+        mDriverHash = HashBytes(driver.data(), driver.size());
+        return mEnabled;
+    }
+
+    bool IsEnabled() const { return mEnabled; }
+    size_t Hits() const { return mHits; }
+    size_t Misses() const { return mMisses; }
+
+    uint64_t Key(const std::vector<std::string> &sources) const
+    {
+        uint64_t key = HashBytes(&VERSION, sizeof(VERSION), mDriverHash);
+        for (const std::string &source : sources)
+        {
+            // the length keeps "ab" + "c" apart from "a" + "bc"
+            uint64_t length = source.size();
+            key = HashBytes(&length, sizeof(length), key);
+            key = HashBytes(source.data(), source.size(), key);
+        }
+        return key;
+    }
+
+    // links program from the cached binary, false if there is none or the driver doesn't accept it
+    bool Load(uint64_t key, GLuint program)
+    {
+        if (!mEnabled)
+            return false;
+        MappedFile file;
+        Header header;
+        if (!file.Open(pathFor(key)) || file.Size() < sizeof(header))
+            return miss();
+        std::memcpy(&header, file.Data(), sizeof(header));
+        if (std::memcmp(header.magic, "RGPB", 4) != 0 || header.version != VERSION || header.key != key
+            || header.size != file.Size() - sizeof(header))
+            return miss();
+        mProgramBinary(program, header.format, file.Data() + sizeof(header), (GLsizei) header.size);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE)
+            return miss();
+        ++mHits;
+        return true;
+    }
+
+    // before glLinkProgram, without the hint some drivers have no binary to return
+    void PrepareLink(GLuint program) const
+    {
+        if (mEnabled)
+            mProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // stores the binary of a successfully linked program, written to a temporary file and renamed into place
+    bool Store(uint64_t key, GLuint program) const
+    {
+        GLint linked = GL_FALSE, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!mEnabled || linked != GL_TRUE)
+            return false;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return false;
+        std::vector<char> binary((size_t) length);
+        Header header;
+        std::memcpy(header.magic, "RGPB", 4);
+        header.version = VERSION;
+        header.key = key;
+        GLsizei written = 0;
+        mGetProgramBinary(program, length, &written, &header.format, binary.data());
+        header.size = (uint64_t) written;
+
+        mkdir(FileSystem::getPath("resources/cache").c_str(), 0755);
+        mkdir(CacheDirectory().c_str(), 0755);
+        std::string path = pathFor(key), tmpPath = path + ".tmp";
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ProgramCache: can't write " << tmpPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(binary.data(), written);
+        out.close();
+        if (!out || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    struct Header {
+        char magic[4];
+        uint32_t version = 0;
+        uint64_t key = 0;
+        GLenum format = 0;
+        uint32_t reserved = 0;
+        uint64_t size = 0;
+    };
+
+    ProgramCache() = default;
+
+    static std::string pathFor(uint64_t key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long) key);
+        return CacheDirectory() + name;
+    }
+
+    bool miss()
+    {
+        ++mMisses;
+        return false;
+    }
+
+    bool mEnabled = false;
+    uint64_t mDriverHash = 0;
+    size_t mHits = 0, mMisses = 0;
+    GetProgramBinaryProc mGetProgramBinary = nullptr;
+    ProgramBinaryProc mProgramBinary = nullptr;
+    ProgramParameteriProc mProgramParameteri = nullptr;
+};
+
+}
+#endif //PROGRAMCACHE_H
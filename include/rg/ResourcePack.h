@@ -0,0 +1,163 @@
+#ifndef RESOURCEPACK_H
+#define RESOURCEPACK_H
+
+#include <rg/MappedFile.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Many asset files in one archive that is mapped once. Layout: header, table of contents (offset, size and
+// path of every file), then the file contents, each starting at a multiple of ALIGNMENT so the arrays inside
+// cooked meshes and textures can be used straight from the mapping. Paths are relative to the project root.
+class ResourcePack
+{
+public:
+    static const uint32_t VERSION = 1;
+    static const uint32_t ALIGNMENT = 64;
+
+    ResourcePack() = default;
+    explicit ResourcePack(const std::string &path) { Open(path); }
+
+    // false if the file is missing or not a pack of this version, the pack stays empty then
+    bool Open(const std::string &path)
+    {
+        mEntries.clear();
+        if (!mMapping.Open(path))
+            return false;
+        const unsigned char *data = mMapping.Data(), *end = data + mMapping.Size();
+        Header header;
+        if (mMapping.Size() < sizeof(header))
+            return fail(path);
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, "RGPK", 4) != 0 || header.version != VERSION)
+            return fail(path);
+        const unsigned char *cur = data + sizeof(header);
+        for (uint32_t i = 0; i < header.entryCount; ++i)
+        {
+            Entry entry;
+            if ((size_t) (end - cur) < sizeof(entry))
+                return fail(path);
+            std::memcpy(&entry, cur, sizeof(entry));
+            cur += sizeof(entry);
+            if ((size_t) (end - cur) < entry.pathLength || entry.offset > mMapping.Size() || entry.size > mMapping.Size() - entry.offset)
+                return fail(path);
+            Blob &blob = mEntries[std::string(reinterpret_cast<const char *>(cur), entry.pathLength)];
+            blob.data = data + entry.offset;
+            blob.size = (size_t) entry.size;
+            cur += entry.pathLength;
+        }
+        return true;
+    }
+
+    bool IsOpen() const { return !mEntries.empty(); }
+    size_t Count() const { return mEntries.size(); }
+    size_t SizeInBytes() const { return mMapping.Size(); }
+
+    // points file at the packed copy of a root relative path, false if the pack doesn't have it
+    bool Find(const std::string &relativePath, MappedFile &file) const
+    {
+        auto it = mEntries.find(relativePath);
+        if (it == mEntries.end())
+            return false;
+        file.View(it->second.data, it->second.size);
+        return true;
+    }
+
+    // writes a pack of the given files, stored under their root relative paths
+    static bool Write(const std::string &packPath, const std::string &root, const std::vector<std::string> &relativePaths)
+    {
+        std::vector<MappedFile> files(relativePaths.size());
+        Header header;
+        std::memcpy(header.magic, "RGPK", 4);
+        header.version = VERSION;
+        header.entryCount = (uint32_t) relativePaths.size();
+        uint64_t offset = sizeof(header);
+        for (const std::string &path : relativePaths)
+            offset += sizeof(Entry) + path.size();
+        std::vector<Entry> entries(relativePaths.size());
+        for (size_t i = 0; i < relativePaths.size(); ++i)
+        {
+            // empty files can't be mapped, they are stored with size 0
+            files[i].Open(root + "/" + relativePaths[i]);
+            offset = align(offset);
+            entries[i].offset = offset;
+            entries[i].size = files[i].Size();
+            entries[i].pathLength = (uint32_t) relativePaths[i].size();
+            offset += files[i].Size();
+        }
+
+        std::string tmpPath = packPath + ".tmp";
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ResourcePack: can't write " << tmpPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            out.write(reinterpret_cast<const char *>(&entries[i]), sizeof(Entry));
+            out.write(relativePaths[i].data(), (std::streamsize) relativePaths[i].size());
+        }
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            static const char padding[ALIGNMENT] = {};
+            out.write(padding, (std::streamsize) (entries[i].offset - (uint64_t) out.tellp()));
+            out.write(reinterpret_cast<const char *>(files[i].Data()), (std::streamsize) files[i].Size());
+        }
+        out.close();
+        if (!out || std::rename(tmpPath.c_str(), packPath.c_str()) != 0)
+        {
+            std::cout << "ResourcePack: can't write " << packPath << std::endl;
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version = 0;
+        uint32_t entryCount = 0;
+        uint32_t reserved = 0;
+    };
+    // followed by pathLength bytes of path, not terminated
+    struct Entry {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t pathLength = 0;
+        uint32_t reserved = 0;
+    };
+    struct Blob {
+        const unsigned char *data = nullptr;
+        size_t size = 0;
+    };
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    bool fail(const std::string &path)
+    {
+        std::cout << "ResourcePack: " << path << " is damaged or from another version, using loose files" << std::endl;
+        mEntries.clear();
+        mMapping.Close();
+        return false;
+    }
+
+    MappedFile mMapping;
+    std::unordered_map<std::string, Blob> mEntries;
+};
+
+}
+#endif //RESOURCEPACK_H
@@ -0,0 +1,228 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/filesystem.h>
+#include <rg/VertexFormat.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Models, their placements, the lights and the info windows of a scene, read from a text file
+// (see resources/scenes/landmarks.scene for the format). Everything that doesn't change while the
+// program runs is computed once here instead of every frame.
+class Scene
+{
+public:
+    struct ModelEntry {
+        std::string name;
+        std::string path;
+        bool flipTextures = false;
+        // textures with cut out parts, drawn with the alpha tested shader variant
+        bool alphaTest = false;
+    };
+
+    struct Instance {
+        size_t model = 0;
+        glm::mat4 transform = glm::mat4(1.0f);
+        // largest axis scale of the transform, the model to world factor of distances
+        float scale = 1.0f;
+        bool castsShadow = true;
+        // world space bounding sphere, valid once SetModelBounds was called for the model
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+    };
+
+    struct InfoRegion {
+        glm::vec2 min = glm::vec2(0.0f);
+        glm::vec2 max = glm::vec2(0.0f);
+        std::string title;
+        std::string text;
+
+        // the rectangle lies in the ground plane, y is ignored
+        bool Contains(const glm::vec3 &position) const
+        {
+            return position.x >= min.x && position.x <= max.x && position.z >= min.y && position.z <= max.y;
+        }
+    };
+
+    struct Lights {
+        bool hasDirectional = false;
+        glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        glm::vec3 ambient = glm::vec3(0.0f);
+        glm::vec3 diffuse = glm::vec3(0.0f);
+        glm::vec3 specular = glm::vec3(0.0f);
+        bool hasPoint = false;
+        glm::vec3 pointPosition = glm::vec3(0.0f);
+    };
+
+    std::vector<ModelEntry> models;
+    std::vector<Instance> instances;
+    std::vector<InfoRegion> regions;
+    Lights lights;
+
+    // parses the file, lines that can't be parsed are reported and skipped. Returns false if the file can't be read
+    bool Load(const std::string &path)
+    {
+        std::string text;
+        if (!FileSystem::readText(path, text))
+        {
+            std::cout << "Scene: can't read " << path << std::endl;
+            return false;
+        }
+        std::istringstream in(text);
+        std::string line;
+        for (int number = 1; std::getline(in, line); ++number)
+        {
+            std::istringstream words(line);
+            std::string keyword;
+            if (!(words >> keyword) || keyword[0] == '#')
+                continue;
+            bool parsed = false;
+            if (keyword == "model")
+                parsed = parseModel(words);
+            else if (keyword == "instance")
+                parsed = parseInstance(words);
+            else if (keyword == "dirlight")
+                parsed = parseDirectionalLight(words);
+            else if (keyword == "pointlight")
+                parsed = parsePointLight(words);
+            else if (keyword == "info")
+                parsed = parseInfo(words);
+            else if (keyword == "text" && !regions.empty())
+            {
+                std::string text;
+                std::getline(words >> std::ws, text);
+                regions.back().text += (regions.back().text.empty() ? "" : "\n") + text;
+                parsed = true;
+            }
+            if (!parsed)
+                std::cout << "Scene: " << path << ":" << number << ": can't parse \"" << line << "\"" << std::endl;
+        }
+        return true;
+    }
+
+    // model space bounds of a model, known once it is imported; places the bounding spheres of its instances
+    void SetModelBounds(size_t model, const VertexBounds &bounds)
+    {
+        glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        float radius = glm::length(bounds.max - bounds.min) * 0.5f;
+        for (Instance &instance : instances)
+            if (instance.model == model)
+            {
+                instance.center = glm::vec3(instance.transform * glm::vec4(center, 1.0f));
+                instance.radius = radius * instance.scale;
+            }
+    }
+
+    // first region containing the position, nullptr if there is none
+    const InfoRegion *RegionAt(const glm::vec3 &position) const
+    {
+        for (const InfoRegion &region : regions)
+            if (region.Contains(position))
+                return &region;
+        return nullptr;
+    }
+
+private:
+    static bool readVec3(std::istream &in, glm::vec3 &v)
+    {
+        return (bool) (in >> v.x >> v.y >> v.z);
+    }
+
+    bool parseModel(std::istream &in)
+    {
+        ModelEntry entry;
+        if (!(in >> entry.name >> entry.path))
+            return false;
+        std::string option;
+        while (in >> option)
+        {
+            if (option == "flip")
+                entry.flipTextures = true;
+            else if (option == "alphatest")
+                entry.alphaTest = true;
+            else
+                return false;
+        }
+        models.push_back(entry);
+        return true;
+    }
+
+    bool parseInstance(std::istream &in)
+    {
+        std::string name;
+        if (!(in >> name))
+            return false;
+        auto model = std::find_if(models.begin(), models.end(), [&](const ModelEntry &entry) { return entry.name == name; });
+        if (model == models.end())
+            return false;
+        Instance instance;
+        instance.model = (size_t) (model - models.begin());
+        std::string op;
+        glm::vec3 v;
+        while (in >> op)
+        {
+            float degrees = 0.0f;
+            if (op == "translate" && readVec3(in, v))
+                instance.transform = glm::translate(instance.transform, v);
+            else if (op == "rotate" && in >> degrees && readVec3(in, v))
+                instance.transform = glm::rotate(instance.transform, glm::radians(degrees), v);
+            else if (op == "scale" && readVec3(in, v))
+                instance.transform = glm::scale(instance.transform, v);
+            else if (op == "noshadow")
+                instance.castsShadow = false;
+            else
+                return false;
+        }
+        const glm::mat4 &t = instance.transform;
+        instance.scale = std::max(glm::length(glm::vec3(t[0])), std::max(glm::length(glm::vec3(t[1])), glm::length(glm::vec3(t[2]))));
+        instances.push_back(instance);
+        return true;
+    }
+
+    bool parseDirectionalLight(std::istream &in)
+    {
+        std::string property;
+        while (in >> property)
+        {
+            glm::vec3 *target = property == "direction" ? &lights.direction : property == "ambient" ? &lights.ambient
+                                : property == "diffuse" ? &lights.diffuse : property == "specular" ? &lights.specular : nullptr;
+            if (!target || !readVec3(in, *target))
+                return false;
+        }
+        lights.hasDirectional = true;
+        return true;
+    }
+
+    bool parsePointLight(std::istream &in)
+    {
+        std::string property;
+        if (!(in >> property) || property != "position" || !readVec3(in, lights.pointPosition))
+            return false;
+        lights.hasPoint = true;
+        return true;
+    }
+
+    bool parseInfo(std::istream &in)
+    {
+        InfoRegion region;
+        if (!(in >> region.min.x >> region.min.y >> region.max.x >> region.max.y))
+            return false;
+        std::getline(in >> std::ws, region.title);
+        if (region.title.empty())
+            return false;
+        regions.push_back(region);
+        return true;
+    }
+};
+
+}
+#endif //SCENE_H
@@ -0,0 +1,123 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <learnopengl/shader.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// features of modelshader.fs, compiled in with a #define instead of branched on per fragment
+enum ModelShaderFeature : unsigned int {
+    SHADER_SHADOWS = 1 << 0,
+    SHADER_SPOTLIGHT = 1 << 1,
+    SHADER_ALPHA_TEST = 1 << 2,
+};
+
+// The programs one set of shader files compiles to with different sets of features. Every feature bit stands
+// for a define, a variant is compiled and set up the first time a draw asks for it (later starts link it from
+// rg::ProgramCache). Variants submitted ahead of that compile while the driver has time for them. GL thread only
+class ShaderVariants
+{
+public:
+    // featureDefines[i] is the define of bit i, setup runs once on every new program (samplers, blocks, ...)
+    ShaderVariants(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath,
+                   const std::vector<std::string> &featureDefines, std::function<void(Shader &)> setup = nullptr)
+    : mVertexPath(vertexPath), mFragmentPath(fragmentPath), mGeometryPath(geometryPath),
+      mFeatureDefines(featureDefines), mSetup(std::move(setup))
+    {
+    }
+
+    ShaderVariants(const ShaderVariants &) = delete;
+    ShaderVariants &operator=(const ShaderVariants &) = delete;
+
+    // features of every following Get(), the ones that follow the settings of the frame
+    void SetBaseFeatures(unsigned int features) { mBaseFeatures = features; }
+    unsigned int BaseFeatures() const { return mBaseFeatures; }
+
+    // starts compiling the variant with the base features and the given ones without waiting for it
+    void Submit(unsigned int features = 0)
+    {
+        variant(features);
+    }
+
+    // every combination of features, only worth it when the driver compiles in parallel
+    void SubmitAll()
+    {
+        for (unsigned int features = 0; features < (1u << mFeatureDefines.size()); ++features)
+            variant(features);
+    }
+
+    // the variant with the base features and the given ones, features without a define are ignored. Finishing
+    // and setting up a new variant leaves it in use
+    Shader &Get(unsigned int features = 0)
+    {
+        Variant &v = variant(features);
+        setUp(v);
+        return *v.shader;
+    }
+
+    // sets up the submitted variants the driver has finished in the background, so the first draw that asks for
+    // one doesn't wait and its binary gets into the program cache. Changes the program in use
+    void FinishReady()
+    {
+        for (auto &entry : mVariants)
+            if (!entry.second.setUp && entry.second.shader->IsReady())
+                setUp(entry.second);
+    }
+
+    // Get() and glUseProgram
+    Shader &Use(unsigned int features = 0)
+    {
+        Shader &shader = Get(features);
+        shader.use();
+        return shader;
+    }
+
+    size_t VariantCount() const { return mVariants.size(); }
+
+private:
+    struct Variant {
+        std::unique_ptr<Shader> shader;
+        bool setUp = false;
+    };
+
+    Variant &variant(unsigned int features)
+    {
+        features = (features | mBaseFeatures) & ((1u << mFeatureDefines.size()) - 1);
+        Variant &v = mVariants[features];
+        if (!v.shader)
+        {
+            std::string defines;
+            for (size_t i = 0; i < mFeatureDefines.size(); ++i)
+                if (features & (1u << i))
+                    defines += "#define " + mFeatureDefines[i] + "\n";
+            v.shader.reset(new Shader(mVertexPath.c_str(), mFragmentPath.c_str(),
+                                      mGeometryPath.empty() ? nullptr : mGeometryPath.c_str(), defines));
+        }
+        return v;
+    }
+
+    void setUp(Variant &v)
+    {
+        if (v.setUp)
+            return;
+        v.shader->use();
+        if (mSetup)
+            mSetup(*v.shader);
+        v.setUp = true;
+    }
+
+    std::string mVertexPath, mFragmentPath, mGeometryPath;
+    std::vector<std::string> mFeatureDefines;
+    std::function<void(Shader &)> mSetup;
+    unsigned int mBaseFeatures = 0;
+    std::map<unsigned int, Variant> mVariants;
+};
+
+}
+#endif //SHADERVARIANTS_H
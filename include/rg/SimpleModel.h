@@ -7,6 +7,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <rg/TextureRegistry.h>
 
 #include <string>
 #include <vector>
@@ -29,80 +30,18 @@ private:
     unsigned int VBO, VAO;
 //    unsigned int EBO;
 
+    // both loaders share textures through the rg::TextureRegistry and only queue the decoding on worker threads,
+    // the pixels are uploaded by rg::TextureLoader::Finish()
     unsigned int loadTexture(const char *path, int wrapParam)
     {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-        if (data)
-        {
-            GLenum format;
-            if (nrComponents == 1)
-                format = GL_RED;
-            else if (nrComponents == 3)
-                format = GL_RGB;
-            else if (nrComponents == 4)
-                format = GL_RGBA;
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            if(wrapParam == GL_REPEAT || wrapParam ==  GL_CLAMP_TO_EDGE)
-            {
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapParam);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapParam);
-            }
-            else
-            {
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-            }
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Texture failed to load at path: " << path << std::endl;
-            stbi_image_free(data);
-        }
-
-        return textureID;
+        rg::TextureParams params;
+        // anything else than GL_REPEAT or GL_CLAMP_TO_EDGE lets the loader decide by the image format
+        params.wrap = (wrapParam == GL_REPEAT || wrapParam == GL_CLAMP_TO_EDGE) ? wrapParam : 0;
+        return rg::TextureRegistry::Instance().Acquire(path, true, params);
     }
     unsigned int loadCubemap(const vector<std::string> &faces)
     {
-        stbi_set_flip_vertically_on_load(false);
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-        int width, height, nrChannels;
-        for (unsigned int i = 0; i < faces.size(); i++)
-        {
-            unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-            if (data)
-            {
-                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-                stbi_image_free(data);
-            }
-            else
-            {
-                std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-                stbi_image_free(data);
-            }
-        }
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-        stbi_set_flip_vertically_on_load(true);
-        return textureID;
+        return rg::TextureRegistry::Instance().AcquireCubemap(faces);
     }
 
 public:
@@ -152,7 +91,7 @@ public:
         glGenBuffers(1, &VBO);
 //        glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        rg::GLState::Instance().BindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(CustomVertex), &mVertices[0], GL_STATIC_DRAW);
 
@@ -190,13 +129,17 @@ public:
 //                                  (void *) offsetof(CustomVertex, Attribute4));
 //        }
 
-        glBindVertexArray(0);
+        rg::GLState::Instance().BindVertexArray(0);
     }
 
     void Destroy()
     {
+        rg::GLState::Instance().ForgetVertexArray(VAO);
         glDeleteVertexArrays(1, &VAO);
         glDeleteBuffers(1, &VBO);
+        for(unsigned int textureID : texIDs)
+            rg::TextureRegistry::Instance().Release(textureID);
+        texIDs.clear();
     }
 
     void AddTexture(const std::string &path, const std::string &name, int value, Shader &shader, int wrapParam=0)
@@ -218,20 +161,14 @@ public:
 
     void Draw(int mode, bool test=false) const
     {
-        glBindVertexArray(VAO);
+        rg::GLState &state = rg::GLState::Instance();
+        state.BindVertexArray(VAO);
         if(hasTexture or hasCubeMaps)
         {
             for(int i=0; i<texIDs.size(); i++)
-            {
-                glActiveTexture(GL_TEXTURE0+i);
-                glBindTexture(hasCubeMaps ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, texIDs[i]);
-            }
+                state.BindTexture(i, hasCubeMaps ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, texIDs[i]);
         }
         glDrawArrays(mode, 0, mVertices.size());
-
-        // set back to default
-        glBindVertexArray(0);
-        glActiveTexture(GL_TEXTURE0);
     }
 };
 
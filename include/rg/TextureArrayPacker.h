@@ -0,0 +1,155 @@
+#ifndef TEXTUREARRAYPACKER_H
+#define TEXTUREARRAYPACKER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/shader.h>
+#include <rg/GLState.h>
+#include <rg/MappedFile.h>
+#include <rg/TextureLoader.h>
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Packs material textures of any number of models into GL_TEXTURE_2D_ARRAY textures, one array per
+// (width, height, channels). Meshes refer to a slot, i.e. an array and a layer, instead of a texture object,
+// so every mesh whose texture landed in the same array draws without another texture bind.
+// Models Add() their textures while uploading, Build() creates the arrays once all of them are added: slots added
+// after a Build get arrays of their own, so build once every model that should share them is uploaded.
+class TextureArrayPacker
+{
+public:
+    // texture unit of the array, shaders sample it through the materialArray and materialLayer uniforms
+    static const int TEXTURE_UNIT = 14;
+
+    struct Slot {
+        std::string path;
+        // until Build() hands it to the TextureLoader, the decoded pixels aren't kept after that
+        PendingImage image;
+        int width = 0, height = 0, channels = 0;
+        unsigned int array = 0;
+        int layer = -1;
+    };
+
+    // size and channel count from the image header, cheap enough to call on the import threads
+    static bool ReadInfo(const std::string &path, int &width, int &height, int &channels)
+    {
+        MappedFile file;
+        return FileSystem::open(path, file) && stbi_info_from_memory(file.Data(), (int) file.Size(), &width, &height, &channels) != 0;
+    }
+
+    // GL thread: registers an image, the same path always gets the same slot
+    int Add(const std::string &path, const PendingImage &image, int width, int height, int channels)
+    {
+        auto it = mSlotByPath.find(path);
+        if (it != mSlotByPath.end())
+            return it->second;
+        Slot slot;
+        slot.path = path;
+        slot.image = image;
+        slot.width = width;
+        slot.height = height;
+        slot.channels = channels;
+        mSlots.push_back(slot);
+        mBuilt = false;
+        return mSlotByPath[path] = (int) mSlots.size() - 1;
+    }
+
+    // GL thread: creates an array for every group of equally sized slots added since the last Build,
+    // the pixels are streamed in by the TextureLoader like any other texture
+    void Build()
+    {
+        GLint maxLayers = 256;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        std::map<std::tuple<int, int, int>, std::vector<size_t>> groups;
+        for (size_t i = 0; i < mSlots.size(); ++i)
+            if (mSlots[i].array == 0)
+                groups[std::make_tuple(mSlots[i].width, mSlots[i].height, mSlots[i].channels)].push_back(i);
+
+        size_t created = 0;
+        for (const auto &group : groups)
+        {
+            const std::vector<size_t> &members = group.second;
+            for (size_t first = 0; first < members.size(); first += maxLayers)
+            {
+                size_t count = std::min(members.size() - first, (size_t) maxLayers);
+                std::vector<PendingImage> layers;
+                for (size_t i = 0; i < count; ++i)
+                    layers.push_back(mSlots[members[first + i]].image);
+                unsigned int array = TextureLoader::Instance().CreateTextureArray(layers);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    mSlots[members[first + i]].array = array;
+                    mSlots[members[first + i]].layer = (int) i;
+                    mSlots[members[first + i]].image = PendingImage();
+                }
+                std::cout << "TextureArrayPacker: " << count << " layers of " << std::get<0>(group.first) << "x"
+                          << std::get<1>(group.first) << "x" << std::get<2>(group.first) << std::endl;
+                ++created;
+            }
+        }
+        if (created)
+            std::cout << "TextureArrayPacker: " << mSlots.size() << " textures in " << CountArrays() << " arrays" << std::endl;
+        mBuilt = true;
+    }
+
+    // false from an Add() until the next Build()
+    bool IsBuilt() const { return mBuilt; }
+
+    const Slot &Get(int slot) const { return mSlots[slot]; }
+    size_t SlotCount() const { return mSlots.size(); }
+
+    size_t CountArrays() const
+    {
+        std::vector<unsigned int> arrays;
+        for (const Slot &slot : mSlots)
+            if (slot.array != 0)
+                arrays.push_back(slot.array);
+        std::sort(arrays.begin(), arrays.end());
+        return (size_t) (std::unique(arrays.begin(), arrays.end()) - arrays.begin());
+    }
+
+    // points the shader at the slot's layer, binds its array only if boundArray holds a different one
+    void Bind(Shader &shader, int slot, unsigned int &boundArray) const
+    {
+        if (slot < 0 || !mBuilt || mSlots[slot].array == 0)
+        {
+            shader.setBool("useMaterialArray", false);
+            boundArray = 0;
+            return;
+        }
+        const Slot &s = mSlots[slot];
+        if (boundArray != s.array)
+        {
+            GLState::Instance().BindTexture(TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, s.array);
+            shader.setInt("materialArray", TEXTURE_UNIT);
+            shader.setBool("useMaterialArray", true);
+            boundArray = s.array;
+        }
+        shader.setFloat("materialLayer", (float) s.layer);
+    }
+
+    // back to the regular material samplers, for everything drawn with the same shader afterwards
+    static void Unbind(Shader &shader)
+    {
+        shader.setBool("useMaterialArray", false);
+    }
+
+private:
+    std::vector<Slot> mSlots;
+    std::unordered_map<std::string, int> mSlotByPath;
+    bool mBuilt = false;
+};
+
+}
+#endif //TEXTUREARRAYPACKER_H
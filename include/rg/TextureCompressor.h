@@ -0,0 +1,507 @@
+#ifndef TEXTURECOMPRESSOR_H
+#define TEXTURECOMPRESSOR_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/filesystem.h>
+#include <rg/GLState.h>
+#include <rg/Image.h>
+#include <rg/MappedFile.h>
+#include <rg/Profiler.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// S3TC is an extension glad wasn't generated with, RGTC is core since 3.0
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace rg {
+
+// block compressed image with its full mip chain down to 1x1, level 0 first
+struct CompressedImage {
+    int width = 0;
+    int height = 0;
+    // channels of the source image, decides the format like FormatFor does for uncompressed images
+    int channels = 0;
+    GLenum format = 0;
+    std::vector<std::vector<unsigned char>> levels;
+
+    bool IsValid() const { return !levels.empty(); }
+    int LevelWidth(size_t level) const { return std::max(1, width >> level); }
+    int LevelHeight(size_t level) const { return std::max(1, height >> level); }
+
+    size_t SizeInBytes() const
+    {
+        size_t size = 0;
+        for (const auto &level : levels)
+            size += level.size();
+        return size;
+    }
+
+    // BC1 (DXT1) for RGB, BC3 (DXT5) for RGBA, BC4 and BC5 (RGTC) for one and two channels
+    static GLenum FormatFor(int channels)
+    {
+        if (channels == 1)
+            return GL_COMPRESSED_RED_RGTC1;
+        if (channels == 2)
+            return GL_COMPRESSED_RG_RGTC2;
+        if (channels == 4)
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+
+    // every format stores 4x4 pixel blocks of 8 or 16 bytes
+    static size_t BlockBytes(GLenum format)
+    {
+        return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RED_RGTC1 ? 8 : 16;
+    }
+
+    static size_t LevelSize(GLenum format, int width, int height)
+    {
+        return (size_t) ((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+};
+
+// GL thread: S3TC is an extension even on GL 3.3 drivers, without it textures stay uncompressed
+inline bool SupportsTextureCompression()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char *name = (const char *) glGetStringi(GL_EXTENSIONS, i);
+        if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+            return true;
+    }
+    return false;
+}
+
+namespace detail {
+
+// 4x4 block of 8-bit pixels, edge blocks repeat the last row and column
+struct PixelBlock {
+    unsigned char pixels[16][4];
+
+    PixelBlock(const unsigned char *image, int width, int height, int channels, int bx, int by)
+    {
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+            {
+                const unsigned char *src = image + ((size_t) std::min(by * 4 + y, height - 1) * width
+                                                    + std::min(bx * 4 + x, width - 1)) * channels;
+                unsigned char *dst = pixels[y * 4 + x];
+                dst[0] = dst[1] = dst[2] = 0;
+                dst[3] = 255;
+                for (int c = 0; c < channels; ++c)
+                    dst[c] = src[c];
+            }
+    }
+};
+
+inline uint16_t packRGB565(const float *color)
+{
+    int r = std::min(31, std::max(0, (int) (color[0] * 31.0f / 255.0f + 0.5f)));
+    int g = std::min(63, std::max(0, (int) (color[1] * 63.0f / 255.0f + 0.5f)));
+    int b = std::min(31, std::max(0, (int) (color[2] * 31.0f / 255.0f + 0.5f)));
+    return (uint16_t) ((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRGB565(uint16_t packed, int *color)
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 color block: endpoints at the extremes of the block's principal axis, always in four color mode
+inline void encodeColorBlock(const PixelBlock &block, unsigned char *out)
+{
+    float mean[3] = {0, 0, 0};
+    for (const auto &p : block.pixels)
+        for (int c = 0; c < 3; ++c)
+            mean[c] += p[c] / 16.0f;
+    float cov[6] = {0, 0, 0, 0, 0, 0};
+    for (const auto &p : block.pixels)
+    {
+        float d[3] = {p[0] - mean[0], p[1] - mean[1], p[2] - mean[2]};
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    // a few power iterations are enough to find the dominant direction
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int i = 0; i < 4; ++i)
+    {
+        float next[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                         cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                         cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        float length = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+        if (length == 0.0f)
+            break;
+        for (int c = 0; c < 3; ++c)
+            axis[c] = next[c] / length;
+    }
+    float minDot = 1e30f, maxDot = -1e30f;
+    int minPixel = 0, maxPixel = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        const unsigned char *p = block.pixels[i];
+        float dot = p[0] * axis[0] + p[1] * axis[1] + p[2] * axis[2];
+        if (dot < minDot) { minDot = dot; minPixel = i; }
+        if (dot > maxDot) { maxDot = dot; maxPixel = i; }
+    }
+    float high[3], low[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        high[c] = block.pixels[maxPixel][c];
+        low[c] = block.pixels[minPixel][c];
+    }
+    uint16_t color0 = packRGB565(high), color1 = packRGB565(low);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for (int e = 0; e < 4; ++e)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; ++c)
+                    distance += (block.pixels[i][c] - palette[e][c]) * (block.pixels[i][c] - palette[e][c]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = e;
+                }
+            }
+            indices |= (uint32_t) best << (2 * i);
+        }
+    }
+    out[0] = (unsigned char) (color0 & 0xFF);
+    out[1] = (unsigned char) (color0 >> 8);
+    out[2] = (unsigned char) (color1 & 0xFF);
+    out[3] = (unsigned char) (color1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = (unsigned char) (indices >> (8 * i));
+}
+
+// BC4 block of one channel (also the alpha block of BC3 and both halves of BC5), in eight value mode
+inline void encodeChannelBlock(const PixelBlock &block, int channel, unsigned char *out)
+{
+    int low = 255, high = 0;
+    for (const auto &p : block.pixels)
+    {
+        low = std::min(low, (int) p[channel]);
+        high = std::max(high, (int) p[channel]);
+    }
+    uint64_t indices = 0;
+    if (high != low)
+    {
+        // index 0 and 1 are the endpoints, 2 to 7 the interpolated values from high to low
+        for (int i = 0; i < 16; ++i)
+        {
+            int step = ((high - block.pixels[i][channel]) * 7 + (high - low) / 2) / (high - low);
+            int index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+            indices |= (uint64_t) index << (3 * i);
+        }
+    }
+    out[0] = (unsigned char) high;
+    out[1] = (unsigned char) low;
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = (unsigned char) (indices >> (8 * i));
+}
+
+inline std::vector<unsigned char> compressLevel(const unsigned char *pixels, int width, int height, int channels, GLenum format)
+{
+    std::vector<unsigned char> blocks(CompressedImage::LevelSize(format, width, height));
+    const size_t blockBytes = CompressedImage::BlockBytes(format);
+    unsigned char *out = blocks.data();
+    for (int by = 0; by < (height + 3) / 4; ++by)
+        for (int bx = 0; bx < (width + 3) / 4; ++bx, out += blockBytes)
+        {
+            PixelBlock block(pixels, width, height, channels, bx, by);
+            if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+                encodeColorBlock(block, out);
+            else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+            {
+                encodeChannelBlock(block, 3, out);
+                encodeColorBlock(block, out + 8);
+            }
+            else if (format == GL_COMPRESSED_RED_RGTC1)
+                encodeChannelBlock(block, 0, out);
+            else
+            {
+                encodeChannelBlock(block, 0, out);
+                encodeChannelBlock(block, 1, out + 8);
+            }
+        }
+    return blocks;
+}
+
+// 2x2 box filter, odd sizes repeat their last row and column
+inline std::vector<unsigned char> downsample(const unsigned char *pixels, int width, int height, int channels)
+{
+    int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    std::vector<unsigned char> result((size_t) w * h * channels);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for (int c = 0; c < channels; ++c)
+            {
+                int sum = pixels[((size_t) y0 * width + x0) * channels + c] + pixels[((size_t) y0 * width + x1) * channels + c]
+                          + pixels[((size_t) y1 * width + x0) * channels + c] + pixels[((size_t) y1 * width + x1) * channels + c];
+                result[((size_t) y * w + x) * channels + c] = (unsigned char) ((sum + 2) / 4);
+            }
+        }
+    return result;
+}
+
+// the subset of the DDS header that compressed 2D textures need
+struct DDSHeader {
+    uint32_t size = 124;
+    uint32_t flags = 0;
+    uint32_t height = 0;
+    uint32_t width = 0;
+    uint32_t linearSize = 0;
+    uint32_t depth = 0;
+    uint32_t mipMapCount = 0;
+    // unused by readers, the cache keeps its own validation data here
+    uint32_t reserved1[11] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    uint32_t formatSize = 32;
+    uint32_t formatFlags = 0;
+    uint32_t fourCC = 0;
+    uint32_t formatBits[5] = {0, 0, 0, 0, 0};
+    uint32_t caps[4] = {0, 0, 0, 0};
+    uint32_t reserved2 = 0;
+};
+
+inline uint32_t fourCC(const char *code)
+{
+    return (uint32_t) code[0] | ((uint32_t) code[1] << 8) | ((uint32_t) code[2] << 16) | ((uint32_t) code[3] << 24);
+}
+
+inline uint32_t fourCCFor(GLenum format)
+{
+    if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        return fourCC("DXT1");
+    if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        return fourCC("DXT5");
+    if (format == GL_COMPRESSED_RED_RGTC1)
+        return fourCC("ATI1");
+    return fourCC("ATI2");
+}
+
+}
+
+// compresses an image and a box filtered mip chain of it
+inline CompressedImage CompressImage(const Image &image)
+{
+    CompressedImage compressed;
+    if (!image.IsValid())
+        return compressed;
+    compressed.width = image.width;
+    compressed.height = image.height;
+    compressed.channels = image.channels;
+    compressed.format = CompressedImage::FormatFor(image.channels);
+    std::vector<unsigned char> level;
+    const unsigned char *pixels = image.pixels.get();
+    int width = image.width, height = image.height;
+    while (true)
+    {
+        compressed.levels.push_back(detail::compressLevel(pixels, width, height, image.channels, compressed.format));
+        if (width == 1 && height == 1)
+            break;
+        level = detail::downsample(pixels, width, height, image.channels);
+        pixels = level.data();
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return compressed;
+}
+
+// Compressed images are cached as DDS files next to the mesh caches. The source hash, the cache version and the
+// channel count live in reserved header fields, an outdated file is simply compressed and written again.
+class TextureCache
+{
+public:
+    // bump whenever the encoder produces different blocks
+    static const uint32_t VERSION = 1;
+
+    static std::string CacheDirectory()
+    {
+        return FileSystem::getPath("resources/cache");
+    }
+
+    // any thread: cached blocks of the image, compressing and storing them first if needed
+    static CompressedImage Load(const std::string &path, bool flipVertically)
+    {
+        CompressedImage compressed;
+        uint64_t sourceHash = 0;
+        {
+            ProfileScope profile("texture cache", path);
+            MappedFile source;
+            if (!FileSystem::open(path, source))
+                return compressed;
+            sourceHash = source.Hash();
+            // a packed copy can be outdated by a newer loose one written after the pack was built
+            std::string cachePath = cachePathFor(path, flipVertically);
+            MappedFile mapping;
+            if ((FileSystem::openPacked(cachePath, mapping) && read(mapping, sourceHash, compressed))
+                || (mapping.Open(cachePath) && read(mapping, sourceHash, compressed)))
+            {
+                profile.AddBytes(compressed.SizeInBytes());
+                return compressed;
+            }
+        }
+        Image image = LoadImage(path, flipVertically);
+        ProfileScope profile("texture compress", path);
+        compressed = CompressImage(image);
+        profile.AddBytes(compressed.SizeInBytes());
+        if (compressed.IsValid())
+            write(cachePathFor(path, flipVertically), sourceHash, compressed);
+        return compressed;
+    }
+
+private:
+    static const uint32_t MARKER = 0x58544752; // "RGTX"
+
+    static std::string cachePathFor(const std::string &path, bool flipVertically)
+    {
+        // the root relative path keeps the name valid inside a resource pack built in another checkout
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        std::string relativePath = FileSystem::getRelativePath(path);
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "-%016llx.dds",
+                      (unsigned long long) HashBytes(relativePath.data(), relativePath.size(), flipVertically ? 1 : 0));
+        return CacheDirectory() + "/" + name + suffix;
+    }
+
+    static bool read(const MappedFile &mapping, uint64_t sourceHash, CompressedImage &compressed)
+    {
+        detail::DDSHeader header;
+        if (mapping.Size() < 4 + sizeof(header) || std::memcmp(mapping.Data(), "DDS ", 4) != 0)
+            return false;
+        std::memcpy(&header, mapping.Data() + 4, sizeof(header));
+        if (header.reserved1[0] != MARKER || header.reserved1[1] != VERSION
+            || header.reserved1[2] != (uint32_t) sourceHash || header.reserved1[3] != (uint32_t) (sourceHash >> 32))
+            return false;
+        compressed.width = (int) header.width;
+        compressed.height = (int) header.height;
+        compressed.channels = (int) header.reserved1[4];
+        compressed.format = CompressedImage::FormatFor(compressed.channels);
+        if (header.fourCC != detail::fourCCFor(compressed.format))
+            return false;
+        // CompressImage always writes the full chain down to 1x1, the loader indexes it up to the smallest level
+        uint32_t fullChain = 1;
+        while (fullChain < 32 && (std::max(header.width, header.height) >> fullChain) > 0)
+            ++fullChain;
+        if (header.width == 0 || header.height == 0 || header.mipMapCount != fullChain)
+            return false;
+        const unsigned char *cur = mapping.Data() + 4 + sizeof(header);
+        const unsigned char *end = mapping.Data() + mapping.Size();
+        for (uint32_t level = 0; level < header.mipMapCount; ++level)
+        {
+            size_t size = CompressedImage::LevelSize(compressed.format, compressed.LevelWidth(level), compressed.LevelHeight(level));
+            if ((size_t) (end - cur) < size)
+            {
+                compressed.levels.clear();
+                return false;
+            }
+            compressed.levels.emplace_back(cur, cur + size);
+            cur += size;
+        }
+        return compressed.IsValid();
+    }
+
+    // written to a temporary file first and renamed into place, other threads may be reading the old one
+    static bool write(const std::string &cachePath, uint64_t sourceHash, const CompressedImage &compressed)
+    {
+        mkdir(CacheDirectory().c_str(), 0755);
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+        std::string tmpPath = cachePath + suffix;
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "TextureCache: can't write " << tmpPath << std::endl;
+            return false;
+        }
+        detail::DDSHeader header;
+        // caps, height, width, pixel format, mip map count and linear size
+        header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+        header.width = (uint32_t) compressed.width;
+        header.height = (uint32_t) compressed.height;
+        header.linearSize = (uint32_t) compressed.levels[0].size();
+        header.mipMapCount = (uint32_t) compressed.levels.size();
+        header.reserved1[0] = MARKER;
+        header.reserved1[1] = VERSION;
+        header.reserved1[2] = (uint32_t) sourceHash;
+        header.reserved1[3] = (uint32_t) (sourceHash >> 32);
+        header.reserved1[4] = (uint32_t) compressed.channels;
+        // four character code
+        header.formatFlags = 0x4;
+        header.fourCC = detail::fourCCFor(compressed.format);
+        // texture, complex, mip map
+        header.caps[0] = 0x1000 | 0x8 | 0x400000;
+        out.write("DDS ", 4);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const auto &level : compressed.levels)
+            out.write(reinterpret_cast<const char *>(level.data()), level.size());
+        out.close();
+        if (!out || std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+// GL thread: creates a complete texture from a compressed image right away, for callers that load synchronously
+inline unsigned int CreateCompressedTexture(const CompressedImage &compressed)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLState::Instance().BindTexture(GL_TEXTURE_2D, textureID);
+    for (size_t level = 0; level < compressed.levels.size(); ++level)
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint) level, compressed.format, compressed.LevelWidth(level), compressed.LevelHeight(level),
+                               0, (GLsizei) compressed.levels[level].size(), compressed.levels[level].data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) compressed.levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
+
+}
+#endif //TEXTURECOMPRESSOR_H
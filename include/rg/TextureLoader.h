@@ -0,0 +1,605 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <glad/glad.h>
+
+#include <rg/GLState.h>
+#include <rg/Image.h>
+#include <rg/Profiler.h>
+#include <rg/TextureCompressor.h>
+#include <rg/ThreadPool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// image decoded on a worker thread together with the time it took, either as pixels or as compressed blocks
+struct DecodedImage {
+    std::string path;
+    Image image;
+    CompressedImage compressed;
+    double decodeMs = 0.0;
+
+    bool IsValid() const { return image.IsValid() || compressed.IsValid(); }
+    bool IsCompressed() const { return compressed.IsValid(); }
+    int Width() const { return IsCompressed() ? compressed.width : image.width; }
+    int Height() const { return IsCompressed() ? compressed.height : image.height; }
+    int Channels() const { return IsCompressed() ? compressed.channels : image.channels; }
+};
+typedef std::shared_future<std::shared_ptr<DecodedImage>> PendingImage;
+
+// sampler settings of a 2D texture. wrap == 0 picks GL_CLAMP_TO_EDGE for RGBA images and GL_REPEAT otherwise
+struct TextureParams {
+    GLint wrap = GL_REPEAT;
+    GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLint magFilter = GL_LINEAR;
+    bool mipmaps = true;
+};
+
+// Texture loading pipeline. Images are decoded on the shared ThreadPool, texture objects are created right away
+// on the GL thread with a 1x1 placeholder and receive their real pixels later, also on the GL thread.
+// Pixels are streamed through a small ring of pixel buffer objects: Update() uploads at most a fixed number
+// of bytes per frame, Finish() uploads everything that is left and blocks until it is done.
+// With compression enabled images are block compressed once, cached by TextureCache and uploaded with their
+// precomputed mip chain instead of being decoded and mipmapped on every start.
+class TextureLoader
+{
+public:
+    struct Timing {
+        std::string path;
+        unsigned int textureID = 0;
+        int width = 0, height = 0, channels = 0;
+        double decodeMs = 0.0;
+        double uploadMs = 0.0;
+        // video memory of the texture and what it would take uncompressed
+        size_t gpuBytes = 0;
+        size_t uncompressedBytes = 0;
+        bool compressed = false;
+    };
+
+    static TextureLoader &Instance()
+    {
+        static TextureLoader loader;
+        return loader;
+    }
+
+    // GL thread, before any Decode(): loads block compressed images from now on, needs SupportsTextureCompression()
+    void SetCompression(bool enabled) { mCompress = enabled; }
+    bool IsCompressing() const { return mCompress; }
+
+    // starts decoding on a worker thread, can be called from any thread
+    PendingImage Decode(const std::string &path, bool flipVertically)
+    {
+        bool compress = mCompress;
+        return ThreadPool::Shared().Submit([path, flipVertically, compress] {
+            auto start = std::chrono::steady_clock::now();
+            auto decoded = std::make_shared<DecodedImage>();
+            decoded->path = path;
+            if (compress)
+                decoded->compressed = TextureCache::Load(path, flipVertically);
+            if (!decoded->IsValid())
+                decoded->image = LoadImage(path, flipVertically);
+            decoded->decodeMs = elapsedMs(start);
+            return decoded;
+        }).share();
+    }
+
+    // GL thread: creates the texture object showing a placeholder until the image is resident
+    unsigned int CreateTexture(const PendingImage &image, const TextureParams &params = TextureParams())
+    {
+        Job job;
+        glGenTextures(1, &job.textureID);
+        job.target = GL_TEXTURE_2D;
+        job.images.push_back(image);
+        job.params = params;
+        GLState::Instance().BindTexture(GL_TEXTURE_2D, job.textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel());
+        mPending.push_back(job);
+        return job.textureID;
+    }
+
+    // GL thread: cubemap from six faces in +X, -X, +Y, -Y, +Z, -Z order
+    unsigned int CreateCubemap(const std::vector<PendingImage> &faces)
+    {
+        Job job;
+        glGenTextures(1, &job.textureID);
+        job.target = GL_TEXTURE_CUBE_MAP;
+        job.images = faces;
+        job.params.wrap = GL_CLAMP_TO_EDGE;
+        job.params.minFilter = GL_LINEAR;
+        job.params.mipmaps = false;
+        GLState::Instance().BindTexture(GL_TEXTURE_CUBE_MAP, job.textureID);
+        for (unsigned int i = 0; i < faces.size(); i++)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel());
+        setParameters(job.target, job.params, GL_RGB);
+        mPending.push_back(job);
+        return job.textureID;
+    }
+
+    // GL thread: 2D array texture with one layer per image, all images need the same size and channel count
+    unsigned int CreateTextureArray(const std::vector<PendingImage> &layers, const TextureParams &params = TextureParams())
+    {
+        Job job;
+        glGenTextures(1, &job.textureID);
+        job.target = GL_TEXTURE_2D_ARRAY;
+        job.images = layers;
+        job.params = params;
+        GLState::Instance().BindTexture(GL_TEXTURE_2D_ARRAY, job.textureID);
+        std::vector<unsigned char> placeholder = placeholderLayers(layers.size());
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, (GLsizei) layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+        mPending.push_back(job);
+        return job.textureID;
+    }
+
+    // bytes uploaded by one Update() call and the size of the staging buffers
+    void SetStreamingBudget(size_t bytesPerFrame, size_t bytesPerBuffer = 1 << 20)
+    {
+        mBytesPerFrame = bytesPerFrame;
+        mBytesPerBuffer = bytesPerBuffer;
+    }
+
+    // GL thread, once per frame: streams up to the frame budget, returns true while textures are still pending
+    bool Update()
+    {
+        return stream(mBytesPerFrame);
+    }
+
+    // GL thread: uploads everything that is pending, waiting for decodes that aren't done yet
+    void Finish()
+    {
+        while (stream(SIZE_MAX))
+        {
+            if (!mActive)
+                for (const PendingImage &image : mPending.front().images)
+                    image.wait();
+        }
+    }
+
+    bool IsIdle() const { return !mActive && mPending.empty(); }
+    // textures created but not resident yet
+    size_t PendingCount() const { return mPending.size() + (mActive ? 1 : 0); }
+
+    // GL thread: forgets a texture that is about to be deleted, uploads still pending for it are dropped
+    void Cancel(unsigned int textureID)
+    {
+        mPending.erase(std::remove_if(mPending.begin(), mPending.end(), [textureID](const Job &job) {
+            return job.textureID == textureID;
+        }), mPending.end());
+        if (mActive && mActive->textureID == textureID)
+            mActive.reset();
+        std::lock_guard<std::mutex> lock(mTimingsMutex);
+        mTimings.erase(std::remove_if(mTimings.begin(), mTimings.end(), [textureID](const Timing &timing) {
+            return timing.textureID == textureID;
+        }), mTimings.end());
+    }
+
+    // prints decode and upload time of every texture loaded so far, slowest first
+    void PrintReport(std::ostream &out = std::cout) const
+    {
+        std::vector<Timing> timings;
+        {
+            std::lock_guard<std::mutex> lock(mTimingsMutex);
+            timings = mTimings;
+        }
+        std::sort(timings.begin(), timings.end(), [](const Timing &a, const Timing &b) {
+            return a.decodeMs + a.uploadMs > b.decodeMs + b.uploadMs;
+        });
+        double decodeTotal = 0.0, uploadTotal = 0.0;
+        size_t gpuTotal = 0, uncompressedTotal = 0;
+        out << "Texture loading (" << timings.size() << " images):\n";
+        out << std::fixed << std::setprecision(2);
+        for (const Timing &timing : timings)
+        {
+            out << "  decode " << std::setw(8) << timing.decodeMs << " ms  upload " << std::setw(8) << timing.uploadMs
+                << " ms  " << timing.width << "x" << timing.height << "x" << timing.channels << (timing.compressed ? " bc  " : "  ")
+                << timing.path << "\n";
+            decodeTotal += timing.decodeMs;
+            uploadTotal += timing.uploadMs;
+            gpuTotal += timing.gpuBytes;
+            uncompressedTotal += timing.uncompressedBytes;
+        }
+        out << "  total decode " << decodeTotal << " ms (on workers), total upload " << uploadTotal << " ms\n";
+        out << "  video memory " << gpuTotal / (1024.0 * 1024.0) << " MB, " << uncompressedTotal / (1024.0 * 1024.0)
+            << " MB uncompressed" << std::endl;
+        out.unsetf(std::ios::floatfield);
+    }
+
+    // video memory of a texture, 0 until it is resident
+    size_t ResidentBytes(unsigned int textureID) const
+    {
+        std::lock_guard<std::mutex> lock(mTimingsMutex);
+        size_t bytes = 0;
+        for (const Timing &timing : mTimings)
+            if (timing.textureID == textureID)
+                bytes += timing.gpuBytes;
+        return bytes;
+    }
+
+    static GLenum FormatFor(int channels)
+    {
+        if (channels == 1)
+            return GL_RED;
+        if (channels == 2)
+            return GL_RG;
+        if (channels == 4)
+            return GL_RGBA;
+        return GL_RGB;
+    }
+
+private:
+    // one texture (cubemap, array) on its way to the GPU, rows are uploaded face (layer) after face
+    struct Job {
+        unsigned int textureID = 0;
+        GLenum target = GL_TEXTURE_2D;
+        std::vector<PendingImage> images;
+        TextureParams params;
+        unsigned int face = 0;
+        // mip level being uploaded, compressed images bring their own mip chain
+        GLint level = 0;
+        int row = 0;
+        GLint placeholderLevel = 0;
+        bool compressed = false;
+        double uploadMs = 0.0;
+    };
+
+    TextureLoader() = default;
+
+    static double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static const unsigned char *placeholderPixel()
+    {
+        static const unsigned char grey[4] = {128, 128, 128, 255};
+        return grey;
+    }
+
+    static std::vector<unsigned char> placeholderLayers(size_t count)
+    {
+        std::vector<unsigned char> pixels(count * 4);
+        for (size_t i = 0; i < count; ++i)
+            std::memcpy(&pixels[i * 4], placeholderPixel(), 4);
+        return pixels;
+    }
+
+    static const char *targetName(GLenum target)
+    {
+        if (target == GL_TEXTURE_CUBE_MAP)
+            return "Cubemap texture";
+        if (target == GL_TEXTURE_2D_ARRAY)
+            return "Array texture";
+        return "Texture";
+    }
+
+    static bool isDecoded(const Job &job)
+    {
+        return std::all_of(job.images.begin(), job.images.end(), [](const PendingImage &image) {
+            return image.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        });
+    }
+
+    static GLenum faceTarget(const Job &job)
+    {
+        return job.target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + job.face : GL_TEXTURE_2D;
+    }
+
+    static void setParameters(GLenum target, const TextureParams &params, GLenum format)
+    {
+        GLint wrap = params.wrap;
+        if (wrap == 0)
+            wrap = format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+        if (target == GL_TEXTURE_CUBE_MAP)
+            glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, params.minFilter);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, params.magFilter);
+    }
+
+    bool stream(size_t byteBudget)
+    {
+        size_t uploaded = 0;
+        while (uploaded < byteBudget)
+        {
+            if (!mActive)
+            {
+                auto ready = std::find_if(mPending.begin(), mPending.end(), isDecoded);
+                if (ready == mPending.end())
+                    break;
+                mActive.reset(new Job(*ready));
+                mPending.erase(ready);
+                if (!begin(*mActive))
+                {
+                    mActive.reset();
+                    continue;
+                }
+            }
+            uploaded += uploadRows(*mActive, byteBudget - uploaded);
+            if (mActive->face == mActive->images.size())
+            {
+                complete(*mActive);
+                mActive.reset();
+            }
+        }
+        return !IsIdle();
+    }
+
+    // levels a job uploads row by row, the placeholder level of compressed images is filled by complete()
+    static GLint streamedLevels(const Job &job)
+    {
+        return job.compressed ? std::max<GLint>(job.placeholderLevel, 1) : 1;
+    }
+
+    // allocates the full size storage but keeps sampling the placeholder, stored in the smallest mip level,
+    // until every row has arrived. Compressed images get storage for all levels above the placeholder
+    bool begin(Job &job)
+    {
+        const DecodedImage &first = *job.images[0].get();
+        for (const PendingImage &image : job.images)
+        {
+            const DecodedImage &decoded = *image.get();
+            if (!decoded.IsValid())
+            {
+                std::cout << targetName(job.target) << " failed to load at path: " << decoded.path << std::endl;
+                return false;
+            }
+            if (decoded.IsCompressed() != first.IsCompressed()
+                || (job.target == GL_TEXTURE_2D_ARRAY && (decoded.Width() != first.Width() || decoded.Height() != first.Height()
+                                                          || decoded.Channels() != first.Channels())))
+            {
+                std::cout << targetName(job.target) << " layer doesn't match the first layer: " << decoded.path << std::endl;
+                return false;
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        GLint levels = 0;
+        while ((std::max(first.Width(), first.Height()) >> levels) > 1)
+            ++levels;
+        job.placeholderLevel = levels;
+        job.compressed = first.IsCompressed();
+
+        GLState::Instance().BindTexture(job.target, job.textureID);
+        for (GLint level = 0; level < streamedLevels(job); ++level)
+        {
+            if (job.target == GL_TEXTURE_2D_ARRAY)
+            {
+                GLsizei width = std::max(1, first.Width() >> level), height = std::max(1, first.Height() >> level);
+                GLsizei layers = (GLsizei) job.images.size();
+                if (job.compressed)
+                {
+                    GLenum format = first.compressed.format;
+                    GLsizei size = (GLsizei) (CompressedImage::LevelSize(format, width, height) * layers);
+                    glCompressedTexImage3D(job.target, level, format, width, height, layers, 0, size, nullptr);
+                }
+                else
+                {
+                    GLenum format = FormatFor(first.Channels());
+                    glTexImage3D(job.target, level, format, width, height, layers, 0, format, GL_UNSIGNED_BYTE, nullptr);
+                }
+                continue;
+            }
+            for (job.face = 0; job.face < job.images.size(); ++job.face)
+            {
+                const DecodedImage &decoded = *job.images[job.face].get();
+                GLsizei width = std::max(1, decoded.Width() >> level), height = std::max(1, decoded.Height() >> level);
+                if (job.compressed)
+                {
+                    GLenum format = decoded.compressed.format;
+                    GLsizei size = (GLsizei) CompressedImage::LevelSize(format, width, height);
+                    glCompressedTexImage2D(faceTarget(job), level, format, width, height, 0, size, nullptr);
+                }
+                else
+                {
+                    GLenum format = FormatFor(decoded.Channels());
+                    glTexImage2D(faceTarget(job), level, format, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+                }
+            }
+        }
+        if (levels > 0)
+        {
+            if (job.target == GL_TEXTURE_2D_ARRAY)
+            {
+                std::vector<unsigned char> placeholder = placeholderLayers(job.images.size());
+                glTexImage3D(job.target, levels, GL_RGBA, 1, 1, (GLsizei) job.images.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+            }
+            else
+            {
+                for (job.face = 0; job.face < job.images.size(); ++job.face)
+                    glTexImage2D(faceTarget(job), levels, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel());
+            }
+        }
+        job.face = 0;
+        glTexParameteri(job.target, GL_TEXTURE_BASE_LEVEL, levels);
+        glTexParameteri(job.target, GL_TEXTURE_MAX_LEVEL, levels);
+        job.uploadMs += elapsedMs(start);
+        return true;
+    }
+
+    // copies bytes into the next staging buffer and leaves it bound as the unpack buffer
+    bool stage(const unsigned char *data, size_t bytes)
+    {
+        if (mBuffers.empty())
+        {
+            mBuffers.resize(3);
+            glGenBuffers((GLsizei) mBuffers.size(), mBuffers.data());
+        }
+        unsigned int buffer = mBuffers[mNextBuffer];
+        mNextBuffer = (mNextBuffer + 1) % mBuffers.size();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        // orphan the previous storage, the GPU may still be reading from it
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void *staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!staging)
+            return false;
+        std::memcpy(staging, data, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        return true;
+    }
+
+    // copies whole rows, rows of 4x4 blocks for compressed images, into the next staging buffer
+    // and lets the GPU pull them from there
+    size_t uploadRows(Job &job, size_t byteBudget)
+    {
+        auto start = std::chrono::steady_clock::now();
+        const DecodedImage &decoded = *job.images[job.face].get();
+        ProfileScope profile(job.target == GL_TEXTURE_CUBE_MAP ? "cubemap upload" : job.target == GL_TEXTURE_2D_ARRAY ? "array upload"
+                             : "texture upload", decoded.path);
+        int width, height, rowHeight;
+        size_t rowBytes;
+        const unsigned char *pixels;
+        if (job.compressed)
+        {
+            const CompressedImage &image = decoded.compressed;
+            width = image.LevelWidth(job.level);
+            height = image.LevelHeight(job.level);
+            rowHeight = 4;
+            rowBytes = CompressedImage::LevelSize(image.format, width, 1);
+            pixels = image.levels[job.level].data();
+        }
+        else
+        {
+            width = decoded.image.width;
+            height = decoded.image.height;
+            rowHeight = 1;
+            rowBytes = (size_t) width * decoded.image.channels;
+            pixels = decoded.image.pixels.get();
+        }
+        size_t maxBytes = std::min(byteBudget, mBytesPerBuffer);
+        int rows = (int) std::max<size_t>(1, maxBytes / rowBytes) * rowHeight;
+        rows = std::min(rows, height - job.row);
+        size_t bytes = (size_t) ((rows + rowHeight - 1) / rowHeight) * rowBytes;
+
+        const unsigned char *rowData = pixels + (size_t) (job.row / rowHeight) * rowBytes;
+        // the staging buffer holds the rows at offset 0, if it can't be mapped they are read from client memory
+        const void *source = nullptr;
+        if (!stage(rowData, bytes))
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            source = rowData;
+        }
+        GLState::Instance().BindTexture(job.target, job.textureID);
+        if (job.compressed)
+        {
+            GLenum format = decoded.compressed.format;
+            if (job.target == GL_TEXTURE_2D_ARRAY)
+                glCompressedTexSubImage3D(job.target, job.level, 0, job.row, (GLint) job.face, width, rows, 1, format, (GLsizei) bytes, source);
+            else
+                glCompressedTexSubImage2D(faceTarget(job), job.level, 0, job.row, width, rows, format, (GLsizei) bytes, source);
+        }
+        else
+        {
+            // rows of 8-bit RGB images are not 4-byte aligned in general
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            GLenum format = FormatFor(decoded.image.channels);
+            if (job.target == GL_TEXTURE_2D_ARRAY)
+                glTexSubImage3D(job.target, 0, 0, job.row, (GLint) job.face, width, rows, 1, format, GL_UNSIGNED_BYTE, source);
+            else
+                glTexSubImage2D(faceTarget(job), 0, 0, job.row, width, rows, format, GL_UNSIGNED_BYTE, source);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        profile.AddBytes(bytes);
+        job.row += rows;
+        if (job.row == height)
+        {
+            job.row = 0;
+            if (++job.level == streamedLevels(job))
+            {
+                job.level = 0;
+                ++job.face;
+            }
+        }
+        job.uploadMs += elapsedMs(start);
+        return bytes;
+    }
+
+    // switches sampling from the placeholder to the uploaded image
+    void complete(Job &job)
+    {
+        auto start = std::chrono::steady_clock::now();
+        const DecodedImage &first = *job.images[0].get();
+        GLState::Instance().BindTexture(job.target, job.textureID);
+        if (job.compressed && job.placeholderLevel > 0)
+        {
+            // the smallest compressed level takes the place of the placeholder
+            GLint level = job.placeholderLevel;
+            GLenum format = first.compressed.format;
+            if (job.target == GL_TEXTURE_2D_ARRAY)
+            {
+                std::vector<unsigned char> blocks;
+                for (const PendingImage &image : job.images)
+                {
+                    const std::vector<unsigned char> &layer = image.get()->compressed.levels[level];
+                    blocks.insert(blocks.end(), layer.begin(), layer.end());
+                }
+                glCompressedTexImage3D(job.target, level, format, first.compressed.LevelWidth(level), first.compressed.LevelHeight(level),
+                                       (GLsizei) job.images.size(), 0, (GLsizei) blocks.size(), blocks.data());
+            }
+            else
+            {
+                for (job.face = 0; job.face < job.images.size(); ++job.face)
+                {
+                    const CompressedImage &image = job.images[job.face].get()->compressed;
+                    glCompressedTexImage2D(faceTarget(job), level, image.format, image.LevelWidth(level), image.LevelHeight(level),
+                                           0, (GLsizei) image.levels[level].size(), image.levels[level].data());
+                }
+            }
+        }
+        glTexParameteri(job.target, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(job.target, GL_TEXTURE_MAX_LEVEL, job.params.mipmaps ? 1000 : 0);
+        // compressed images come with their mip chain
+        if (job.params.mipmaps && !job.compressed)
+        {
+            ProfileScope profile("mipmap generation", first.path);
+            glGenerateMipmap(job.target);
+        }
+        setParameters(job.target, job.params, FormatFor(first.Channels()));
+        job.uploadMs += elapsedMs(start);
+
+        for (const PendingImage &image : job.images)
+        {
+            const DecodedImage &decoded = *image.get();
+            Timing timing;
+            timing.path = decoded.path;
+            timing.textureID = job.textureID;
+            timing.width = decoded.Width();
+            timing.height = decoded.Height();
+            timing.channels = decoded.Channels();
+            timing.decodeMs = decoded.decodeMs;
+            timing.uploadMs = job.uploadMs / job.images.size();
+            timing.compressed = decoded.IsCompressed();
+            timing.uncompressedBytes = (size_t) decoded.Width() * decoded.Height() * decoded.Channels();
+            // a full mip chain adds a third
+            if (job.params.mipmaps)
+                timing.uncompressedBytes = timing.uncompressedBytes * 4 / 3;
+            timing.gpuBytes = decoded.IsCompressed() ? decoded.compressed.SizeInBytes() : timing.uncompressedBytes;
+            std::lock_guard<std::mutex> lock(mTimingsMutex);
+            mTimings.push_back(timing);
+        }
+    }
+
+    std::vector<Job> mPending;
+    std::unique_ptr<Job> mActive;
+    std::vector<unsigned int> mBuffers;
+    size_t mNextBuffer = 0;
+    size_t mBytesPerFrame = 4 << 20;
+    size_t mBytesPerBuffer = 1 << 20;
+    bool mCompress = false;
+    std::vector<Timing> mTimings;
+    mutable std::mutex mTimingsMutex;
+};
+
+}
+#endif //TEXTURELOADER_H
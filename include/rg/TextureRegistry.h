@@ -0,0 +1,192 @@
+#ifndef TEXTUREREGISTRY_H
+#define TEXTUREREGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/filesystem.h>
+#include <rg/GLState.h>
+#include <rg/MappedFile.h>
+#include <rg/TextureLoader.h>
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rg {
+
+// Process wide owner of image textures. A texture is identified by the contents of its image files, the flip
+// and its sampler settings, so the same image is created once no matter under which path or by whom it is
+// requested. Acquire() hands out a reference, Release() drops one and deletes the texture with the last one.
+// Used from the GL thread only.
+class TextureRegistry
+{
+public:
+    static TextureRegistry &Instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    // 2D texture of an image file. A pending decode of the file can be handed in, it is used if the texture is new
+    unsigned int Acquire(const std::string &path, bool flipVertically, const TextureParams &params = TextureParams(),
+                         const PendingImage *decoded = nullptr)
+    {
+        uint64_t key = paramsKey(GL_TEXTURE_2D, params, flipVertically, contentIdentity(path));
+        auto it = mEntries.find(key);
+        if (it != mEntries.end())
+            return reuse(it->second);
+        TextureLoader &loader = TextureLoader::Instance();
+        unsigned int textureID = loader.CreateTexture(decoded ? *decoded : loader.Decode(path, flipVertically), params);
+        return insert(key, textureID);
+    }
+
+    // cubemap from six faces in +X, -X, +Y, -Y, +Z, -Z order
+    unsigned int AcquireCubemap(const std::vector<std::string> &faces)
+    {
+        uint64_t contents = 0;
+        for (const std::string &face : faces)
+        {
+            uint64_t identity = contentIdentity(face);
+            contents = HashBytes(&identity, sizeof(identity), contents);
+        }
+        TextureParams params;
+        params.wrap = GL_CLAMP_TO_EDGE;
+        params.minFilter = GL_LINEAR;
+        params.mipmaps = false;
+        uint64_t key = paramsKey(GL_TEXTURE_CUBE_MAP, params, false, contents);
+        auto it = mEntries.find(key);
+        if (it != mEntries.end())
+            return reuse(it->second);
+        TextureLoader &loader = TextureLoader::Instance();
+        std::vector<PendingImage> pendingFaces;
+        for (const std::string &face : faces)
+            pendingFaces.push_back(loader.Decode(face, false));
+        return insert(key, loader.CreateCubemap(pendingFaces));
+    }
+
+    // drops a reference, textures the registry doesn't know are left alone
+    void Release(unsigned int textureID)
+    {
+        auto key = mKeyByTexture.find(textureID);
+        if (key == mKeyByTexture.end())
+            return;
+        Entry &entry = mEntries[key->second];
+        if (--entry.references > 0)
+            return;
+        TextureLoader::Instance().Cancel(textureID);
+        GLState::Instance().ForgetTexture(textureID);
+        glDeleteTextures(1, &textureID);
+        mEntries.erase(key->second);
+        mKeyByTexture.erase(key);
+    }
+
+    // live textures, their references and the video memory deduplication saved so far
+    void PrintReport(std::ostream &out = std::cout) const
+    {
+        size_t references = 0, hits = 0, savedBytes = 0;
+        const TextureLoader &loader = TextureLoader::Instance();
+        for (const auto &it : mEntries)
+        {
+            const Entry &entry = it.second;
+            references += entry.references;
+            hits += entry.acquires - 1;
+            savedBytes += (entry.acquires - 1) * loader.ResidentBytes(entry.textureID);
+        }
+        out << std::fixed << std::setprecision(2);
+        out << "Texture registry: " << mEntries.size() << " textures, " << references << " references, " << hits
+            << " duplicate requests saved " << savedBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+        out.unsetf(std::ios::floatfield);
+    }
+
+private:
+    struct Entry {
+        unsigned int textureID = 0;
+        unsigned int references = 0;
+        // every Acquire of the texture, including the first one and the released ones
+        unsigned int acquires = 0;
+    };
+
+    // a file of some size, hashed once another file of the same size shows up
+    struct SizedFile {
+        std::string path;
+        uint64_t hash = 0;
+        bool hashed = false;
+    };
+
+    TextureRegistry() = default;
+
+    // Same for files with the same contents, without reading them on the GL thread in the common case: only
+    // files of equal size can be duplicates, so a file is hashed only when another one has its size. Duplicates
+    // take the identity of the first file, the others and missing files are identified by their path
+    uint64_t contentIdentity(const std::string &path)
+    {
+        auto known = mIdentities.find(path);
+        if (known != mIdentities.end())
+            return known->second;
+        uint64_t identity = HashBytes(path.data(), path.size());
+        MappedFile file;
+        // mapping doesn't read the file yet
+        if (FileSystem::open(path, file))
+        {
+            std::vector<SizedFile> &sameSize = mFilesBySize[file.Size()];
+            SizedFile sized;
+            sized.path = path;
+            if (!sameSize.empty())
+            {
+                sized.hash = file.Hash();
+                sized.hashed = true;
+                for (SizedFile &other : sameSize)
+                    if (contentHash(other) == sized.hash)
+                    {
+                        identity = mIdentities[other.path];
+                        break;
+                    }
+            }
+            sameSize.push_back(sized);
+        }
+        return mIdentities[path] = identity;
+    }
+
+    static uint64_t contentHash(SizedFile &file)
+    {
+        if (!file.hashed)
+        {
+            MappedFile mapping;
+            file.hash = FileSystem::open(file.path, mapping) ? mapping.Hash() : 0;
+            file.hashed = true;
+        }
+        return file.hash;
+    }
+
+    static uint64_t paramsKey(GLenum target, const TextureParams &params, bool flipVertically, uint64_t contents)
+    {
+        int32_t values[6] = {(int32_t) target, params.wrap, params.minFilter, params.magFilter, params.mipmaps, flipVertically};
+        return HashBytes(values, sizeof(values), contents);
+    }
+
+    unsigned int reuse(Entry &entry)
+    {
+        ++entry.references;
+        ++entry.acquires;
+        return entry.textureID;
+    }
+
+    unsigned int insert(uint64_t key, unsigned int textureID)
+    {
+        Entry &entry = mEntries[key];
+        entry.textureID = textureID;
+        mKeyByTexture[textureID] = key;
+        return reuse(entry);
+    }
+
+    std::unordered_map<uint64_t, Entry> mEntries;
+    std::unordered_map<unsigned int, uint64_t> mKeyByTexture;
+    std::unordered_map<std::string, uint64_t> mIdentities;
+    std::unordered_map<size_t, std::vector<SizedFile>> mFilesBySize;
+};
+
+}
+#endif //TEXTUREREGISTRY_H
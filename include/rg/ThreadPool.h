@@ -0,0 +1,129 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace rg {
+
+// Fixed size pool of worker threads for CPU-only loading work (parsing, decoding).
+// Tasks must not touch OpenGL, the context is current only on the main thread.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = DefaultThreadCount())
+    {
+        for (unsigned int i = 0; i < threadCount; ++i)
+            mWorkers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mCondition.notify_all();
+        for (std::thread &worker : mWorkers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> Submit(F &&function)
+    {
+        using Result = typename std::result_of<F()>::type;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.emplace_back([task] { (*task)(); });
+        }
+        mCondition.notify_one();
+        return result;
+    }
+
+    // Calls function(i) for every i in [0, count) and returns once all calls are done. The calling thread works
+    // through the indices together with the workers, so this doesn't deadlock when called from a pool task.
+    template<typename F>
+    void ParallelFor(size_t count, F function)
+    {
+        struct State {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto state = std::make_shared<State>();
+        // helpers that start after every index is taken return without calling function
+        auto work = [state, count, function]()
+        {
+            for (size_t i = state->next++; i < count; i = state->next++)
+            {
+                function(i);
+                if (++state->done == count)
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->finished.notify_all();
+                }
+            }
+        };
+        for (size_t i = 1; i < std::min<size_t>(count, Size() + 1); ++i)
+            Submit(work);
+        work();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&] { return state->done == count; });
+    }
+
+    unsigned int Size() const { return (unsigned int) mWorkers.size(); }
+
+    // pool shared by all loaders (models, textures), lives until the program exits
+    static ThreadPool &Shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    static unsigned int DefaultThreadCount()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+private:
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+                if (mStopping && mTasks.empty())
+                    return;
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStopping = false;
+};
+
+}
+#endif //THREADPOOL_H
@@ -0,0 +1,130 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <cstddef>
+
+namespace rg {
+
+// binding points of the blocks every program shares, GLSL 330 can't name them in the shader
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+
+// std140 mirrors of the blocks declared in resources/shaders. A vec3 takes 16 bytes there unless a float
+// follows it, so every vec3 is followed by a float of the block or by padding
+struct CameraBlock {
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+    float padding0 = 0.0f;
+};
+
+struct DirLightBlock {
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    float padding0 = 0.0f;
+    glm::vec3 ambient = glm::vec3(0.0f);
+    float padding1 = 0.0f;
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    float padding2 = 0.0f;
+    glm::vec3 specular = glm::vec3(0.0f);
+    float padding3 = 0.0f;
+};
+
+struct SpotLightBlock {
+    glm::vec3 position = glm::vec3(0.0f);
+    float cutOff = 0.0f;
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    float outerCutOff = 0.0f;
+    glm::vec3 ambient = glm::vec3(0.0f);
+    float constant = 1.0f;
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    float linear = 0.0f;
+    glm::vec3 specular = glm::vec3(0.0f);
+    float quadratic = 0.0f;
+};
+
+struct PointLightBlock {
+    glm::vec3 position = glm::vec3(0.0f);
+    float constant = 1.0f;
+    glm::vec3 ambient = glm::vec3(0.0f);
+    float linear = 0.0f;
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    float quadratic = 0.0f;
+    glm::vec3 specular = glm::vec3(0.0f);
+    float padding0 = 0.0f;
+};
+
+struct LightsBlock {
+    DirLightBlock dirLight;
+    SpotLightBlock spotLight;
+    PointLightBlock pointLight;
+};
+
+static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::mat4) == 64, "glm types don't match GLSL");
+static_assert(sizeof(CameraBlock) == 144 && offsetof(CameraBlock, viewPos) == 128, "CameraBlock isn't std140");
+static_assert(sizeof(DirLightBlock) == 64 && sizeof(SpotLightBlock) == 80 && sizeof(PointLightBlock) == 64,
+              "light structs aren't std140");
+static_assert(offsetof(LightsBlock, spotLight) == 64 && offsetof(LightsBlock, pointLight) == 144, "LightsBlock isn't std140");
+
+// One or more copies of a block in a single uniform buffer, each at an offset the binding point can be pointed
+// at. Call Destroy() before the context goes away
+template<typename T>
+class UniformBuffer
+{
+public:
+    explicit UniformBuffer(GLuint binding, size_t copies = 1)
+    : mBinding(binding), mCopies(copies)
+    {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        mStride = (sizeof(T) + alignment - 1) / alignment * alignment;
+        glGenBuffers(1, &mBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr) (mStride * mCopies), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        Bind(0);
+    }
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    void Upload(const T &value, size_t copy = 0)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr) (copy * mStride), sizeof(T), &value);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // points the binding at one of the copies, the programs read that one from the next draw on
+    void Bind(size_t copy = 0) const
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, mBinding, mBuffer, (GLintptr) (copy * mStride), sizeof(T));
+    }
+
+    void Destroy()
+    {
+        glDeleteBuffers(1, &mBuffer);
+        mBuffer = 0;
+    }
+
+    // connects the program's block of that name to the binding, programs without the block are left alone
+    static void Attach(const Shader &shader, const char *blockName, GLuint binding)
+    {
+        GLuint index = glGetUniformBlockIndex(shader.ID, blockName);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(shader.ID, index, binding);
+    }
+
+private:
+    GLuint mBinding;
+    size_t mCopies;
+    size_t mStride = 0;
+    GLuint mBuffer = 0;
+};
+
+}
+#endif //UNIFORMBUFFER_H
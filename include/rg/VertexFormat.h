@@ -0,0 +1,255 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// attribute locations used by Mesh and the shaders in resources/shaders
+enum VertexAttribute {
+    ATTRIB_POSITION = 0,
+    ATTRIB_NORMAL = 1,
+    ATTRIB_TEXCOORDS = 2,
+    ATTRIB_TANGENT = 3,
+    ATTRIB_BITANGENT = 4,
+    ATTRIB_COUNT = 5
+};
+const unsigned int ALL_VERTEX_ATTRIBUTES = (1u << ATTRIB_COUNT) - 1;
+
+// Full: 32-bit floats everywhere.
+// Compact: positions as unsigned normalized shorts relative to the mesh bounds, normal/tangent/bitangent as
+// signed normalized 10_10_10_2 and texture coordinates as half floats.
+enum class VertexFormat {
+    Full,
+    Compact
+};
+
+struct VertexBounds {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+};
+
+// where every attribute lives inside one packed vertex
+struct VertexLayout {
+    struct Attribute {
+        bool enabled = false;
+        GLint size = 0;
+        GLenum type = GL_FLOAT;
+        GLboolean normalized = GL_FALSE;
+        size_t offset = 0;
+    };
+    VertexFormat format = VertexFormat::Full;
+    unsigned int mask = ALL_VERTEX_ATTRIBUTES;
+    Attribute attributes[ATTRIB_COUNT];
+    size_t stride = 0;
+
+    // attributes missing from the mask are not stored at all
+    static VertexLayout Create(VertexFormat format, unsigned int mask)
+    {
+        static const GLint floatSizes[ATTRIB_COUNT] = {3, 3, 2, 3, 3};
+        VertexLayout layout;
+        layout.format = format;
+        layout.mask = mask | (1u << ATTRIB_POSITION);
+        for (int i = 0; i < ATTRIB_COUNT; ++i)
+        {
+            Attribute &attribute = layout.attributes[i];
+            attribute.enabled = (layout.mask & (1u << i)) != 0;
+            if (!attribute.enabled)
+                continue;
+            attribute.offset = layout.stride;
+            if (format == VertexFormat::Full)
+            {
+                attribute.size = floatSizes[i];
+                attribute.type = GL_FLOAT;
+                layout.stride += floatSizes[i] * sizeof(float);
+            }
+            else if (i == ATTRIB_POSITION)
+            {
+                // 4th component is padding, keeps every attribute 4-byte aligned
+                attribute.size = 3;
+                attribute.type = GL_UNSIGNED_SHORT;
+                attribute.normalized = GL_TRUE;
+                layout.stride += 4 * sizeof(uint16_t);
+            }
+            else if (i == ATTRIB_TEXCOORDS)
+            {
+                attribute.size = 2;
+                attribute.type = GL_HALF_FLOAT;
+                layout.stride += 2 * sizeof(uint16_t);
+            }
+            else
+            {
+                attribute.size = 4;
+                attribute.type = GL_INT_2_10_10_10_REV;
+                attribute.normalized = GL_TRUE;
+                layout.stride += sizeof(uint32_t);
+            }
+        }
+        return layout;
+    }
+
+    // true if a packed vertex is byte for byte the Vertex struct, then no conversion is needed
+    template<typename VertexT>
+    bool IsNative() const
+    {
+        return format == VertexFormat::Full && mask == ALL_VERTEX_ATTRIBUTES && stride == sizeof(VertexT);
+    }
+
+    // sets the attribute pointers of the currently bound VAO/VBO
+    void Apply() const
+    {
+        for (int i = 0; i < ATTRIB_COUNT; ++i)
+        {
+            const Attribute &attribute = attributes[i];
+            if (!attribute.enabled)
+                continue;
+            glEnableVertexAttribArray(i);
+            glVertexAttribPointer(i, attribute.size, attribute.type, attribute.normalized, (GLsizei) stride, (void *) attribute.offset);
+        }
+    }
+};
+
+// matrix that maps compact (0..1 normalized) positions back to model space
+inline glm::mat4 DequantizeMatrix(const VertexBounds &bounds)
+{
+    glm::vec3 extent = bounds.max - bounds.min;
+    for (int i = 0; i < 3; ++i)
+        if (extent[i] <= 0.0f)
+            extent[i] = 1.0f;
+    return glm::scale(glm::translate(glm::mat4(1.0f), bounds.min), extent);
+}
+
+// signed normalized 10_10_10_2, x in the lowest bits as GL_INT_2_10_10_10_REV expects
+inline uint32_t PackSnorm1010102(const glm::vec3 &v)
+{
+    auto component = [](float value) {
+        int quantized = (int) std::lround(std::max(-1.0f, std::min(1.0f, value)) * 511.0f);
+        return (uint32_t) quantized & 0x3FFu;
+    };
+    return component(v.x) | (component(v.y) << 10) | (component(v.z) << 20);
+}
+
+inline uint16_t QuantizeUnorm16(float value, float min, float max)
+{
+    float range = max - min;
+    float normalized = range > 0.0f ? (value - min) / range : 0.0f;
+    return (uint16_t) std::lround(std::max(0.0f, std::min(1.0f, normalized)) * 65535.0f);
+}
+
+template<typename VertexT>
+VertexBounds ComputeBounds(const VertexT *vertices, size_t count)
+{
+    VertexBounds bounds;
+    if (count == 0)
+        return bounds;
+    bounds.min = bounds.max = vertices[0].Position;
+    for (size_t i = 1; i < count; ++i)
+    {
+        bounds.min = glm::min(bounds.min, vertices[i].Position);
+        bounds.max = glm::max(bounds.max, vertices[i].Position);
+    }
+    return bounds;
+}
+
+// converts vertices into the given layout, compact positions are quantized relative to bounds
+template<typename VertexT>
+std::vector<unsigned char> PackVertices(const VertexLayout &layout, const VertexT *vertices, size_t count, const VertexBounds &bounds)
+{
+    std::vector<unsigned char> packed(count * layout.stride, 0);
+    const VertexLayout::Attribute *attributes = layout.attributes;
+    glm::mat4 dequantize = DequantizeMatrix(bounds);
+    glm::vec3 extent = glm::vec3(dequantize[0][0], dequantize[1][1], dequantize[2][2]);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const VertexT &vertex = vertices[i];
+        unsigned char *out = packed.data() + i * layout.stride;
+        const glm::vec3 *directions[ATTRIB_COUNT] = {nullptr, &vertex.Normal, nullptr, &vertex.Tangent, &vertex.Bitangent};
+        if (layout.format == VertexFormat::Full)
+        {
+            std::memcpy(out + attributes[ATTRIB_POSITION].offset, &vertex.Position, sizeof(glm::vec3));
+            if (attributes[ATTRIB_TEXCOORDS].enabled)
+                std::memcpy(out + attributes[ATTRIB_TEXCOORDS].offset, &vertex.TexCoords, sizeof(glm::vec2));
+            for (int a : {ATTRIB_NORMAL, ATTRIB_TANGENT, ATTRIB_BITANGENT})
+                if (attributes[a].enabled)
+                    std::memcpy(out + attributes[a].offset, directions[a], sizeof(glm::vec3));
+            continue;
+        }
+        uint16_t position[4] = {
+                QuantizeUnorm16(vertex.Position.x, bounds.min.x, bounds.max.x),
+                QuantizeUnorm16(vertex.Position.y, bounds.min.y, bounds.max.y),
+                QuantizeUnorm16(vertex.Position.z, bounds.min.z, bounds.max.z),
+                0
+        };
+        std::memcpy(out + attributes[ATTRIB_POSITION].offset, position, sizeof(position));
+        if (attributes[ATTRIB_TEXCOORDS].enabled)
+        {
+            uint16_t uv[2] = {glm::packHalf1x16(vertex.TexCoords.x), glm::packHalf1x16(vertex.TexCoords.y)};
+            std::memcpy(out + attributes[ATTRIB_TEXCOORDS].offset, uv, sizeof(uv));
+        }
+        for (int a : {ATTRIB_NORMAL, ATTRIB_TANGENT, ATTRIB_BITANGENT})
+        {
+            if (!attributes[a].enabled)
+                continue;
+            // the shaders transform normals with transpose(inverse(model)), which now includes the dequantize
+            // scale, so normals are pre-scaled by the extent and tangents by its inverse to cancel it out
+            glm::vec3 value = a == ATTRIB_NORMAL ? *directions[a] * extent : *directions[a] / extent;
+            float length = glm::length(value);
+            uint32_t direction = PackSnorm1010102(length > 0.0f ? value / length : value);
+            std::memcpy(out + attributes[a].offset, &direction, sizeof(direction));
+        }
+    }
+    return packed;
+}
+
+// meshes with at most this many vertices can be drawn with 16-bit indices
+const size_t MAX_SHORT_INDEXED_VERTICES = 65536;
+
+inline GLenum IndexTypeFor(size_t vertexCount)
+{
+    return vertexCount <= MAX_SHORT_INDEXED_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+inline size_t IndexSize(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+// narrows indices of a mesh that passes IndexTypeFor
+inline std::vector<uint16_t> PackIndices16(const unsigned int *indices, size_t count)
+{
+    return std::vector<uint16_t>(indices, indices + count);
+}
+
+// bit mask of the attribute locations a linked program actually reads
+inline unsigned int ActiveAttributeMask(GLuint program)
+{
+    GLint count = 0;
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+    unsigned int mask = 0;
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLchar name[256];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(program, (GLuint) i, sizeof(name), &length, &size, &type, name);
+        GLint location = glGetAttribLocation(program, name);
+        if (location >= 0 && location < ATTRIB_COUNT)
+            mask |= 1u << location;
+    }
+    return mask;
+}
+
+}
+#endif //VERTEXFORMAT_H
@@ -11,6 +11,7 @@ struct Material {
     sampler2D ambient;
     float shininess;
 };
+// the light structs are std140 mirrors of the ones in rg/UniformBuffer.h, the floats fill the vec3s up to 16 bytes
 struct DirLight {
     vec3 direction;
 
@@ -20,64 +21,92 @@ struct DirLight {
 };
 struct PointLight {
     vec3 position;
-
     float constant;
-    float linear;
-    float quadratic;
 
     vec3 ambient;
+    float linear;
     vec3 diffuse;
+    float quadratic;
     vec3 specular;
 };
 struct SpotLight {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
 
-    float constant;
-    float linear;
-    float quadratic;
-
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;
+    float quadratic;
 };
+// SHADOWS, SPOTLIGHT and ALPHA_TEST are defined per variant, see rg::ShaderVariants
+#ifdef SHADOWS
 uniform float far_plane;
 uniform samplerCube depthMap;
-uniform bool shadows;
+#endif
 
-uniform vec3 viewPos;
+// per-frame camera, filled from rg::CameraBlock
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+// per-frame lights, filled from rg::LightsBlock
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+    PointLight pointLight;
+};
 uniform Material material;
-uniform DirLight dirLight;
-uniform SpotLight spotLight;
-uniform PointLight pointLight;
-uniform vec3 cameraPos;
+// models packed by rg::TextureArrayPacker sample one layer of an array texture instead of the material maps
+uniform bool useMaterialArray;
+uniform sampler2DArray materialArray;
+uniform float materialLayer;
 
+#ifdef SHADOWS
 float ShadowCalculation(vec3 fragPos);
+#endif
 vec4 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec4 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 vec4 allAmbient = vec4(0.0);
 
+vec4 materialTexture(sampler2D map)
+{
+    return useMaterialArray ? texture(materialArray, vec3(TexCoord, materialLayer)) : texture(map, TexCoord);
+}
+
 
 void main()
 {
+#ifdef ALPHA_TEST
+    // mean alpha of the material maps, before any light is computed
+    float alpha = (materialTexture(material.diffuse).a + materialTexture(material.specular).a
+                   + materialTexture(material.ambient).a) / 3.0;
+    if(alpha < 0.7)
+       discard;
+#endif
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
     vec4 result = CalcDirLight(dirLight, norm, viewDir);
+#ifdef SPOTLIGHT
     result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
+#endif
     result += CalcPointLight(pointLight, norm, FragPos, viewDir);
-    result += allAmbient;
-    float shadow = shadows ? ShadowCalculation(FragPos) : 0.0;
+#ifdef SHADOWS
+    float shadow = ShadowCalculation(FragPos);
+#else
+    float shadow = 0.0;
+#endif
 
-    if(result.a/9.0 < 0.7)
-       discard;
-    result -= allAmbient;
 	FragColor = vec4((allAmbient.xyz)+(result.xyz)*(1.0-shadow), 1.0);
 }
 
+#ifdef SHADOWS
 float ShadowCalculation(vec3 fragPos)
 {
     // get vector between fragment position and light position
@@ -96,6 +125,7 @@ float ShadowCalculation(vec3 fragPos)
 
     return shadow;
 }
+#endif
 
 // I'm using vec4 just because I want to save the alpha parameter from texture() function and use it for Blending the grass
 // instead of making another shader to do just discard blend. Math logic for advanced light stays the same
@@ -108,9 +138,9 @@ vec4 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 halfwayDir = normalize(lightDir+viewDir);
     float spec = pow(max(dot(viewDir, halfwayDir), 0.0), material.shininess);
     // combine results
-    vec4 ambient = vec4(light.ambient, 1.0) * texture(material.ambient, TexCoord);
-    vec4 diffuse = vec4(light.diffuse * diff, 1.0)  * texture(material.diffuse, TexCoord);
-    vec4 specular = vec4(light.specular * spec, 1.0) * texture(material.specular, TexCoord);
+    vec4 ambient = vec4(light.ambient, 1.0) * materialTexture(material.ambient);
+    vec4 diffuse = vec4(light.diffuse * diff, 1.0)  * materialTexture(material.diffuse);
+    vec4 specular = vec4(light.specular * spec, 1.0) * materialTexture(material.specular);
     allAmbient += ambient;
     return (diffuse + specular);
 }
@@ -132,9 +162,9 @@ vec4 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
     float attInt = attenuation * intensity;
-    vec4 ambient = vec4(light.ambient * attInt, 1.0) * texture(material.ambient, TexCoord);
-    vec4 diffuse = vec4(light.diffuse * diff * attInt, 1.0)  * texture(material.diffuse, TexCoord);
-    vec4 specular = vec4(light.specular * spec * attInt, 1.0) * texture(material.specular, TexCoord);
+    vec4 ambient = vec4(light.ambient * attInt, 1.0) * materialTexture(material.ambient);
+    vec4 diffuse = vec4(light.diffuse * diff * attInt, 1.0)  * materialTexture(material.diffuse);
+    vec4 specular = vec4(light.specular * spec * attInt, 1.0) * materialTexture(material.specular);
     allAmbient += ambient;
     return (diffuse + specular);
 }
@@ -152,9 +182,9 @@ vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
     // combine results
-    vec4 ambient = vec4(light.ambient * attenuation, 1.0) * texture(material.ambient, TexCoord);
-    vec4 diffuse = vec4(light.diffuse * diff * attenuation, 1.0)  * texture(material.diffuse, TexCoord);
-    vec4 specular = vec4(light.specular * spec * attenuation, 1.0) * texture(material.specular, TexCoord);
+    vec4 ambient = vec4(light.ambient * attenuation, 1.0) * materialTexture(material.ambient);
+    vec4 diffuse = vec4(light.diffuse * diff * attenuation, 1.0)  * materialTexture(material.diffuse);
+    vec4 specular = vec4(light.specular * spec * attenuation, 1.0) * materialTexture(material.specular);
     allAmbient += ambient;
     return (diffuse + specular);
 }
@@ -18,6 +18,19 @@
 #include "rg/TPPCamera.h"
 #include "rg/FPSCamera.h"
 
+#include "rg/GLState.h"
+#include "rg/Memory.h"
+#include "rg/ModelQueue.h"
+#include "rg/ParallelShaderCompile.h"
+#include "rg/ProgramCache.h"
+#include "rg/Profiler.h"
+#include "rg/Scene.h"
+#include "rg/ShaderVariants.h"
+#include "rg/ThreadPool.h"
+#include "rg/UniformBuffer.h"
+
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <random>
 
@@ -31,22 +44,32 @@ void SaveStateSettings(const std::string& path);
 void LoadStateSettings(const std::string& path);
 
 
-void DrawSkybox(Shader &shader, const SimpleModel &skyboxModel, glm::mat4 projection);
-void DrawGrassGround(Shader &shader, SimpleModel &grassPlane, SimpleModel &grass, std::vector<glm::vec3> &grassPos, glm::mat4 projection);
-void DrawAllStationeryModels(std::vector<Model> &statModels, Shader &shader, glm::mat4 projection);
-void DrawAxis(Shader &shader, const SimpleModel &axisSModel, const std::vector<glm::vec3> &axisColor, glm::mat4 projection);
-void SetLightParameters(Shader &shader);
+void DrawSkybox(Shader &shader, const SimpleModel &skyboxModel);
+void DrawGrassGround(rg::ShaderVariants &shaders, SimpleModel &grassPlane, SimpleModel &grass, std::vector<glm::vec3> &grassPos,
+                     const rg::UniformBuffer<rg::LightsBlock> &lights);
+void DrawAllStationeryModels(std::vector<Model> &statModels, rg::ShaderVariants &shaders);
+void DrawAxis(Shader &shader, const SimpleModel &axisSModel, const std::vector<glm::vec3> &axisColor);
+void UpdateFrameUniforms(rg::UniformBuffer<rg::CameraBlock> &camera, rg::UniformBuffer<rg::LightsBlock> &lights,
+                         const glm::mat4 &projection);
 void DrawImGuiInfoWindows();
-void DrawCVarAndAxis(GLFWwindow *window, Shader &shader, const SimpleModel &axisSModel, const std::vector<glm::vec3> &axisColor, glm::mat4 projection);
-void DrawAirBalloon(Shader &shader, Model &mm, glm::mat4 projection);
+void DrawCVarAndAxis(GLFWwindow *window, Shader &shader, const SimpleModel &axisSModel, const std::vector<glm::vec3> &axisColor);
+void DrawAirBalloon(rg::ShaderVariants &shaders, Model &mm);
 void AirBalloonIdleEvent(GLFWwindow *window);
+void DrawLoadingOverlay(const rg::ModelQueue &models, size_t pendingTextures);
 
-void renderScene(Shader &shader, SimpleModel &grassPlane, SimpleModel &grass, std::vector<glm::vec3> &grassPos,
-                 std::vector<Model> &statModels, Model &hot_air_balloon, glm::mat4 projection,
+void renderScene(rg::ShaderVariants &shaders, SimpleModel &grassPlane, SimpleModel &grass, std::vector<glm::vec3> &grassPos,
+                 std::vector<Model> &statModels, Model &hot_air_balloon, const rg::UniformBuffer<rg::LightsBlock> &lights,
                  GLFWwindow *window);
 // window settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// show frames while the landmark models are still loading, they appear as soon as they are uploaded
+const bool PROGRESSIVE_STARTUP = true;
+// range of the point light's shadow cube map
+const float SHADOW_NEAR_PLANE = 1.f;
+const float SHADOW_FAR_PLANE = 40.0f;
+// also write the startup profile as a Chrome trace, for chrome://tracing or ui.perfetto.dev
+const bool WRITE_STARTUP_TRACE = false;
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
@@ -74,6 +97,9 @@ struct ProgramState {
     bool isCVars = false;
     float scaleWidth = SCR_WIDTH/10.0f;
     float scaleHeight = SCR_HEIGHT/1.2f;
+    // size of the default framebuffer, follows window resizes
+    int framebufferWidth = SCR_WIDTH;
+    int framebufferHeight = SCR_HEIGHT;
 
     // Directional Light is in this scenario Sun and its parameters should be the same for all objects on the scene
     glm::vec3 dirLight = glm::vec3(0.1f, -1.2f, 1.f);
@@ -85,19 +111,39 @@ struct ProgramState {
     // shadows
     bool shadows = false;
     bool disableGrass = true;
+    // level of detail of the stationery models, every +1 doubles the tolerated error on screen
+    float lodBias = 0.0f;
 
     ProgramState() = default;
 };
 ProgramState *programState;
 MainModelState *mainModelState;
+// landmarks, lights and info windows from resources/scenes
+rg::Scene *scene;
 FPSCamera *fps_camera;
 TPPCamera *tpp_camera;
 
 int main()
 {
+    // the startup profile counts from here
+    rg::Profiler &profiler = rg::Profiler::Instance();
     // setup and load default variables
     programState = new ProgramState;
     mainModelState = new MainModelState;
+    scene = new rg::Scene;
+    {
+        rg::ProfileScope profile("scene load", "resources/scenes/landmarks.scene");
+        scene->Load(FileSystem::getPath("resources/scenes/landmarks.scene"));
+    }
+    if (scene->lights.hasDirectional)
+    {
+        programState->dirLight = scene->lights.direction;
+        programState->dirAmbient = scene->lights.ambient;
+        programState->dirDiffuse = scene->lights.diffuse;
+        programState->dirSpecular = scene->lights.specular;
+    }
+    if (scene->lights.hasPoint)
+        programState->pointLight = scene->lights.pointPosition;
     fps_camera = new FPSCamera(glm::vec3(.5f, .8f, -3.0f), glm::vec3(0.0f, 1.0f, 0.0f), 90.f);
     tpp_camera = new TPPCamera(glm::vec3(.0f, .0f, 0.f), mainModelState->mmPosition,
                                glm::vec3(0.0f, 1.0f, 0.0f), -90.f, 40.f);
@@ -105,24 +151,29 @@ int main()
     LoadStateSettings("save.txt");
 
     // glfw: initialize and configure
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window;
+    {
+        rg::ProfileScope profile("glfw init");
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw window creation
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT,"AirGasBag",
-                                          nullptr, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        // glfw window creation
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT,"AirGasBag",
+                                  nullptr, NULL);
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
     }
-    glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwGetFramebufferSize(window, &programState->framebufferWidth, &programState->framebufferHeight);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetKeyCallback(window, key_callback);
@@ -130,18 +181,27 @@ int main()
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     // glad: load all OpenGL function pointers
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+    {
+        rg::ProfileScope profile("glad init");
+        if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
+        // glad has no entry points for program binaries or parallel compiling, these load their own
+        rg::ProgramCache::Instance().Init((GLADloadproc) glfwGetProcAddress);
+        rg::ParallelShaderCompile::Instance().Init((GLADloadproc) glfwGetProcAddress);
     }
 
     // Init Imgui
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO &io = ImGui::GetIO(); (void) io;
-    ImGui::StyleColorsDark();
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330 core");
+    {
+        rg::ProfileScope profile("imgui init");
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO &io = ImGui::GetIO(); (void) io;
+        ImGui::StyleColorsDark();
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330 core");
+    }
 
     // Random number generator
     std::default_random_engine dre;
@@ -149,38 +209,123 @@ int main()
     double upperBound = 25;
     std::uniform_real_distribution<double> uniformDouble(lowerBound,upperBound);
 
-    // configure global opengl state
-    glEnable(GL_DEPTH_TEST);
+    // configure global opengl state, the state rg::GLState tracks only changes through it
+    rg::GLState &glState = rg::GLState::Instance();
+    glState.Enable(GL_DEPTH_TEST);
     glCullFace(GL_FRONT);
+    // textures load as cached BC1/BC3 blocks with their mip chains, if the driver can sample them
+    rg::TextureLoader::Instance().SetCompression(rg::SupportsTextureCompression());
 
-    // build and compile shaders
+    // build and compile shaders, or link them from the program cache after the first start. Every program is
+    // submitted before the first one is waited for, so the driver can compile them side by side
+    auto shadersStart = std::chrono::steady_clock::now();
     Shader axisShader("resources/shaders/axisshader.vs", "resources/shaders/axisshader.fs");
-    Shader modelShader("resources/shaders/modelshader.vs", "resources/shaders/modelshader.fs");
     Shader grassPlaneShader("resources/shaders/modelshader.vs", "resources/shaders/modelshader.fs");
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
-    Shader depthShader("resources/shaders/depthshader.vs",
-                       "resources/shaders/depthshader.fs",
-                       "resources/shaders/depthshader.gs");
+    auto setupModelShader = [](Shader &shader) {
+        // the material array sampler gets a unit of its own, a 2D array may not share one with the 2D material samplers
+        shader.setInt("materialArray", rg::TextureArrayPacker::TEXTURE_UNIT);
+        shader.setFloat("material.shininess", 32.f);
+        shader.setInt("depthMap", 15);
+        shader.setFloat("far_plane", SHADOW_FAR_PLANE);
+        rg::UniformBuffer<rg::CameraBlock>::Attach(shader, "Camera", rg::CAMERA_BLOCK_BINDING);
+        rg::UniformBuffer<rg::LightsBlock>::Attach(shader, "Lights", rg::LIGHTS_BLOCK_BINDING);
+    };
+    // one program per set of features in use, in the order of the rg::ModelShaderFeature bits
+    rg::ShaderVariants modelShaders("resources/shaders/modelshader.vs", "resources/shaders/modelshader.fs", "",
+                                    {"SHADOWS", "SPOTLIGHT", "ALPHA_TEST"}, setupModelShader);
+    rg::ShaderVariants depthShaders("resources/shaders/depthshader.vs",
+                                    "resources/shaders/depthshader.fs",
+                                    "resources/shaders/depthshader.gs", {});
+    // the variants of the first frames, the third person camera without shadows; the others compile when asked
+    // for, or in the background with a driver that compiles in parallel
+    modelShaders.Submit(rg::SHADER_SPOTLIGHT);
+    modelShaders.Submit(rg::SHADER_SPOTLIGHT | rg::SHADER_ALPHA_TEST);
+    depthShaders.Submit();
+    if (rg::ParallelShaderCompile::Instance().IsEnabled())
+        modelShaders.SubmitAll();
+    modelShaders.Get(rg::SHADER_SPOTLIGHT);
+    modelShaders.Get(rg::SHADER_SPOTLIGHT | rg::SHADER_ALPHA_TEST);
+    Shader &depthShader = depthShaders.Get();
+    {
+        const rg::ProgramCache &programs = rg::ProgramCache::Instance();
+        std::cout << "Shaders ready in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shadersStart).count() << " ms, "
+                  << (!programs.IsEnabled() ? std::string("program cache unsupported by the driver")
+                      : programs.Misses() == 0 ? "warm start, all from the program cache"
+                      : "cold start, " + std::to_string(programs.Misses()) + " compiled")
+                  << (rg::ParallelShaderCompile::Instance().IsEnabled() ? ", in parallel" : "") << std::endl;
+    }
+    grassPlaneShader.use();
+    setupModelShader(grassPlaneShader);
+    // camera and lights are uploaded once per frame into uniform blocks all programs read,
+    // the second copy of the lights is the one the grass blades are drawn with
+    rg::UniformBuffer<rg::CameraBlock> cameraBuffer(rg::CAMERA_BLOCK_BINDING);
+    rg::UniformBuffer<rg::LightsBlock> lightsBuffer(rg::LIGHTS_BLOCK_BINDING, 2);
+    for (Shader *shader : {&skyboxShader, &axisShader})
+    {
+        rg::UniformBuffer<rg::CameraBlock>::Attach(*shader, "Camera", rg::CAMERA_BLOCK_BINDING);
+        rg::UniformBuffer<rg::LightsBlock>::Attach(*shader, "Lights", rg::LIGHTS_BLOCK_BINDING);
+    }
 
     // models:
-    // tell stb_image.h to flip loaded texture's on the y-axis (before loading model)
-    stbi_set_flip_vertically_on_load(false);
-    // stationery models
-    Model tree_house("resources/objects/tree_house/10783_TreeHouse_v7_LOD3.obj");
-    Model pisa_tower("resources/objects/pisa_tower/10076_pisa_tower_v1_max2009_it0.obj");
-    Model big_ben("resources/objects/big_ben/10059_big_ben_v2_max2011_it1.obj");
-    Model christ_redeemer("resources/objects/christ_redeemer/12331_Christ_Rio_V1_L1.obj");
-    // some models' textures are flipped correctly
-    stbi_set_flip_vertically_on_load(true);
-    Model liberty_statue("resources/objects/liberty_statue/LibertStatue.obj");
-    Model tree("resources/objects/tree/Tree.obj");
+    // compact vertices with only the attributes the model and depth shaders read, one buffer pair per model
+    ModelOptions compact;
+    compact.vertexFormat = rg::VertexFormat::Compact;
+    // every variant reads the same attributes, the one of the first frames is already compiled
+    compact.vertexAttributes = rg::ActiveAttributeMask(modelShaders.Get(rg::SHADER_SPOTLIGHT).ID) | rg::ActiveAttributeMask(depthShader.ID);
+    compact.mergeMeshes = true;
+    // first textures of all materials packed into arrays, so models of the same texture size share one bind.
+    // The landmarks' arrays are built once all of them are uploaded, the balloon has its own for the first frame
+    rg::TextureArrayPacker materialArrays;
+    rg::TextureArrayPacker balloonArrays;
+    compact.textureArrays = &materialArrays;
+    // some models' textures are flipped correctly, so flipping on the y-axis is chosen per model
+    ModelOptions flipped = compact;
+    flipped.flipTextures = true;
+    ModelOptions balloonOptions = flipped;
+    balloonOptions.textureArrays = &balloonArrays;
+    // stationery models, in the order of the scene file
+    std::vector<Model> stationery_models;
+    stationery_models.reserve(scene->models.size());
+    for (const rg::Scene::ModelEntry &entry : scene->models)
+        stationery_models.emplace_back(entry.path, entry.flipTextures ? flipped : compact);
     // main model
-    Model hot_air_balloon("resources/objects/hot_air_balloon/11809_Hot_air_balloon_l2.obj");
-
-    std::vector<Model> stationery_models
-    {
-            tree_house, pisa_tower, big_ben, christ_redeemer, liberty_statue, tree
+    Model hot_air_balloon("resources/objects/hot_air_balloon/11809_Hot_air_balloon_l2.obj", balloonOptions);
+
+    std::vector<Model *> all_models{&hot_air_balloon};
+    for (Model &m : stationery_models)
+        all_models.push_back(&m);
+    // all models import in the background, the balloon is needed for the first frame,
+    // the landmarks are uploaded one per frame once the render loop runs and show up together after the last one
+    rg::ModelQueue modelQueue;
+    for (Model *m : all_models)
+        modelQueue.Add(m);
+    if (PROGRESSIVE_STARTUP)
+        modelQueue.Wait(&hot_air_balloon);
+    else
+        modelQueue.Finish();
+    size_t releasedGeometry = 0;
+    auto modelsUploaded = [&]() {
+        // packed models draw once their arrays are built, the landmarks' only when all of them can share them
+        if (hot_air_balloon.IsUploaded() && !balloonArrays.IsBuilt())
+            balloonArrays.Build();
+        if (modelQueue.IsDone())
+            materialArrays.Build();
+        // bounding spheres of the placements, computed once per model
+        for (size_t i = 0; i < stationery_models.size(); ++i)
+            if (stationery_models[i].IsUploaded())
+                scene->SetModelBounds(i, stationery_models[i].Bounds());
+        // the geometry lives in GPU buffers now, nothing reads the CPU copies anymore
+        for (Model *m : all_models)
+            if (m->IsUploaded())
+                releasedGeometry += m->ReleaseGeometry();
+        if (modelQueue.IsDone())
+            std::cout << "Loaded " << modelQueue.Count() << " models in " << modelQueue.LoadSeconds() << "s, released "
+                      << releasedGeometry / (1024.0 * 1024.0) << " MB of CPU geometry, resident memory "
+                      << rg::ResidentMemoryBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
     };
+    modelsUploaded();
 
     // simple models:
     // axis
@@ -295,7 +440,18 @@ int main()
         FileSystem::getPath("resources/textures/skybox/back.jpg")
     };
     SimpleModel skyboxSModel(skybox_vertices);
-    skyboxSModel.AddCubemaps(faces, "skybox", 0, skyboxShader);
+    {
+        // the faces decode on the workers and upload in the render loop, see "image decode" and "cubemap upload"
+        rg::ProfileScope profile("cubemap load", "resources/textures/skybox");
+        skyboxSModel.AddCubemaps(faces, "skybox", 0, skyboxShader);
+    }
+
+    // textures are still decoding, the render loop streams them in and shows placeholders until then
+    rg::TextureLoader &textureLoader = rg::TextureLoader::Instance();
+    textureLoader.SetStreamingBudget(4 << 20);
+    bool texturesResident = false;
+    bool firstFrame = true;
+    bool startupProfiled = false;
 
     // configure depth map FBO
     // -----------------------
@@ -305,7 +461,7 @@ int main()
     // create depth cube map texture
     unsigned int depthCubemap;
     glGenTextures(1, &depthCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+    glState.BindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
     for (unsigned int i = 0; i < 6; ++i)
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -337,6 +493,28 @@ int main()
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // stream a bounded amount of texture data per frame
+        if (!texturesResident && !textureLoader.Update())
+        {
+            texturesResident = true;
+            textureLoader.PrintReport();
+            rg::TextureRegistry::Instance().PrintReport();
+        }
+
+        // one more model per frame until all of them are in
+        if (!modelQueue.IsDone() && modelQueue.Update())
+            modelsUploaded();
+
+        // everything is loaded, the profile covers the whole startup
+        if (!startupProfiled && texturesResident && modelQueue.IsDone())
+        {
+            startupProfiled = true;
+            profiler.SetEnabled(false);
+            profiler.PrintReport();
+            if (WRITE_STARTUP_TRACE)
+                profiler.WriteChromeTrace(FileSystem::getPath("startup_trace.json"));
+        }
+
         // input
         processInput(window);
         // render
@@ -345,10 +523,12 @@ int main()
 
         // 0. create depth cube map transformation matrices
         // -----------------------------------------------
-        modelShader.use();
-        modelShader.setBool("shadows", programState->shadows);
-        float near_plane = 1.f;
-        float far_plane  = 40.0f;
+        // the features of this frame's model shader variants, the ones compiled in the background are set up
+        modelShaders.FinishReady();
+        modelShaders.SetBaseFeatures((programState->shadows ? (unsigned int) rg::SHADER_SHADOWS : 0u)
+                                     | (programState->camera == tpp_camera ? (unsigned int) rg::SHADER_SPOTLIGHT : 0u));
+        float near_plane = SHADOW_NEAR_PLANE;
+        float far_plane  = SHADOW_FAR_PLANE;
         glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT, near_plane, far_plane);
         std::vector<glm::mat4> shadowTransforms;
         shadowTransforms.push_back(shadowProj * glm::lookAt(programState->pointLight, programState->pointLight + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
@@ -369,39 +549,48 @@ int main()
         depthShader.setFloat("far_plane", far_plane);
         depthShader.setVec3("lightPos", programState->pointLight);
         programState->disableGrass = true;
-        renderScene(depthShader, grassPlaneSModel, grassSModel, grass_translate,
-                    stationery_models, hot_air_balloon, projection, window);
+        renderScene(depthShaders, grassPlaneSModel, grassSModel, grass_translate,
+                    stationery_models, hot_air_balloon, lightsBuffer, window);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
         // 2. render scene as normal
         // -------------------------
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        glViewport(0, 0, programState->framebufferWidth, programState->framebufferHeight);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        modelShader.use();
-        modelShader.setInt("depthMap", 15);
-        modelShader.setFloat("far_plane", far_plane);
-        glActiveTexture(GL_TEXTURE15);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+        glState.BindTexture(15, GL_TEXTURE_CUBE_MAP, depthCubemap);
 
         // projection
         projection = glm::perspective(glm::radians(programState->camera->Zoom),
-                                      (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+                                      (float)programState->framebufferWidth / (float)std::max(programState->framebufferHeight, 1), 0.1f, 100.0f);
+        // camera and lights for all programs, once per frame
+        UpdateFrameUniforms(cameraBuffer, lightsBuffer, projection);
         programState->disableGrass = false;
-        renderScene(modelShader, grassPlaneSModel, grassSModel, grass_translate,
-                    stationery_models, hot_air_balloon, projection, window);
+        renderScene(modelShaders, grassPlaneSModel, grassSModel, grass_translate,
+                    stationery_models, hot_air_balloon, lightsBuffer, window);
 
         // drawing skybox
-        DrawSkybox(skyboxShader, skyboxSModel, projection);
+        DrawSkybox(skyboxShader, skyboxSModel);
         // drawing ImGui windows
         DrawImGuiInfoWindows();
-        DrawCVarAndAxis(window, axisShader, axisSModel, axisColor, projection);
+        DrawCVarAndAxis(window, axisShader, axisSModel, axisColor);
+        if (!modelQueue.IsDone() || !texturesResident)
+            DrawLoadingOverlay(modelQueue, textureLoader.PendingCount());
         // ImGui render
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // the ImGui renderer sets GL state behind the tracker's back
+        glState.Invalidate();
+        glState.EndFrame();
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         glfwSwapBuffers(window);
         glfwPollEvents();
+        if (firstFrame)
+        {
+            // the GLFW timer starts with glfwInit()
+            std::cout << "First interactive frame after " << glfwGetTime() << "s" << std::endl;
+            firstFrame = false;
+        }
     }
 
     SaveStateSettings("save.txt");
@@ -413,12 +602,17 @@ int main()
     delete tpp_camera;
     delete programState;
     delete mainModelState;
+    delete scene;
     // if we put content of Destroy() method into ~SimpleModel destructor, glfwTerminate() causes SEGFAULT
     // probably glfwTerminate() is freeing by itself those VAOs and VBOs
     axisSModel.Destroy();
     grassPlaneSModel.Destroy();
     grassSModel.Destroy();
     skyboxSModel.Destroy();
+    cameraBuffer.Destroy();
+    lightsBuffer.Destroy();
+    for (Model *m : all_models)
+        m->ReleaseTextures();
     // glfw: terminate, clearing all previously allocated GLFW resources.
     glfwTerminate();
 
@@ -525,6 +719,8 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    programState->framebufferWidth = width;
+    programState->framebufferHeight = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -573,65 +769,56 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         programState->shadows = !programState->shadows;
 }
 
-void DrawSkybox(Shader &shader, const SimpleModel &skyboxModel, glm::mat4 projection)
+void DrawSkybox(Shader &shader, const SimpleModel &skyboxModel)
 {
-    glDepthFunc(GL_LEQUAL);
+    rg::GLState &state = rg::GLState::Instance();
+    state.DepthFunc(GL_LEQUAL);
     shader.use();
-    glm::mat4 view = glm::mat4(glm::mat3(programState->camera->GetViewMatrix()));
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
     skyboxModel.Draw(GL_TRIANGLES, true);
-    glDepthFunc(GL_LESS);
+    state.DepthFunc(GL_LESS);
 }
 
-void DrawGrassGround(Shader &shader, SimpleModel &grassPlane, SimpleModel &grass, std::vector<glm::vec3> &grassPos, glm::mat4 projection)
+void DrawGrassGround(rg::ShaderVariants &shaders, SimpleModel &grassPlane, SimpleModel &grass, std::vector<glm::vec3> &grassPos,
+                     const rg::UniformBuffer<rg::LightsBlock> &lights)
 {
-    glm::mat4 view = programState->camera->GetViewMatrix();
     glm::mat4 model = glm::mat4(1.0f);
-    shader.use();
+    // grass textures have cut out parts
+    Shader &shader = shaders.Use(rg::SHADER_ALPHA_TEST);
 
     // grass is using custom light parameters because it doesn't have any additional tex maps
     if(!programState->disableGrass)
     {
-        shader.setVec3("viewPos", programState->camera->Position);
-        shader.setVec3("dirLight.direction", programState->dirLight);
-        shader.setVec3("dirLight.ambient", 1.f, 1.f, 1.f);
-        shader.setVec3("dirLight.diffuse", 1.f, 1.f, 1.f);
+        lights.Bind(1);
+        // only the model matrix changes per blade
+        Shader::Uniform modelUniform = shader.GetUniform("model");
         for (int i = 0; i < grassPos.size(); ++i) {
             model = glm::mat4(1.0f);
             model = glm::translate(model, grassPos[i]);
             if (i < grassPos.size() / 2)
                 model = glm::rotate(model, glm::radians(90.f), glm::vec3(0.0f, 1.0f, 0.0f));
             model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
-            shader.setMat4("model", model);
-            shader.setMat4("projection", projection);
-            shader.setMat4("view", view);
+            shader.setMat4(modelUniform, model);
             grass.Draw(GL_TRIANGLES);
         }
     }
     // ground plane
-    SetLightParameters(shader);
+    lights.Bind(0);
     model = glm::mat4(1.0f);
-    glEnable(GL_CULL_FACE);
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
+    rg::GLState::Instance().Enable(GL_CULL_FACE);
     shader.setMat4("model", model);
     grassPlane.Draw(GL_TRIANGLES);
-    glDisable(GL_CULL_FACE);
+    rg::GLState::Instance().Disable(GL_CULL_FACE);
 }
 
-void DrawAirBalloon(Shader &shader, Model &mm, glm::mat4 projection)
+void DrawAirBalloon(rg::ShaderVariants &shaders, Model &mm)
 {
-    shader.use();
+    Shader &shader = shaders.Use();
     glm::mat4 model = glm::mat4(1.0f);
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", programState->camera->GetViewMatrix());
     model = glm::translate(model, mainModelState->mmPosition);
     model = glm::rotate(model, glm::radians(mainModelState->mmAngle), mainModelState->mmRotation);
     model = glm::rotate(model, glm::radians(mainModelState->mmTurnAngle), glm::vec3(0.f, 0.f, 1.f));
     model = glm::scale(model, glm::vec3(.0009f, .0009f, 0.0007f));
-    shader.setMat4("model", model);
-    mm.Draw(shader);
+    mm.Draw(shader, model);
 }
 
 void AirBalloonIdleEvent(GLFWwindow *window)
@@ -652,67 +839,29 @@ void AirBalloonIdleEvent(GLFWwindow *window)
     }
 }
 
-void DrawAllStationeryModels(std::vector<Model> &statModels, Shader &shader, glm::mat4 projection)
+void DrawAllStationeryModels(std::vector<Model> &statModels, rg::ShaderVariants &shaders)
 {
-    // 0:tree_house, 1:pisa_tower, 2:big_ben, 3:christ_redeemer, 4:liberty_statue
-    shader.use();
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view = programState->camera->GetViewMatrix();
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
-    // tree_house
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-2.f, 0.f, 3.f));
-    model = glm::rotate(model, glm::radians(-90.f), glm::vec3(1.0f, .0f, .0f));
-    model = glm::scale(model, glm::vec3(.015f, .015f, 0.015f));
-    shader.setMat4("model", model);
-    statModels[0].Draw(shader);
-    // pisa_tower
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(15.f, 0.f, 10.f));
-    model = glm::rotate(model, glm::radians(-90.f), glm::vec3(1.0f, .0f, .0f));
-    model = glm::scale(model, glm::vec3(.0015f, .0015f, 0.0015f));
-    shader.setMat4("model", model);
-    statModels[1].Draw(shader);
-    // big_ben
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-20.f, 0.f, -5.f));
-    model = glm::rotate(model, glm::radians(-90.f), glm::vec3(1.0f, .0f, .0f));
-    model = glm::scale(model, glm::vec3(.0025f, .0025f, 0.0025f));
-    shader.setMat4("model", model);
-    statModels[2].Draw(shader);
-    // christ_redeemer
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(0.f, 0.f, 15.f));
-    model = glm::rotate(model, glm::radians(-90.f), glm::vec3(1.0f, .0f, .0f));
-    model = glm::rotate(model, glm::radians(-90.f), glm::vec3(.0f, 0.f, 1.0f));
-    model = glm::scale(model, glm::vec3(.001f, .001f, 0.001f));
-    shader.setMat4("model", model);
-    statModels[3].Draw(shader);
-    // liberty_statue
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(5.f, 0.f, -15.f));
-    model = glm::scale(model, glm::vec3(15.f, 15.f, 15.f));
-    shader.setMat4("model", model);
-    statModels[4].Draw(shader);
-    // tree
-    if(!programState->disableGrass)
+    rg::LodSelector lod;
+    lod.cameraPosition = programState->camera->Position;
+    lod.projectionScale = rg::LodSelector::ProjectionScale(glm::radians(programState->camera->Zoom),
+                                                               (float) std::max(programState->framebufferHeight, 1));
+    lod.bias = programState->lodBias;
+    for (const rg::Scene::Instance &instance : scene->instances)
     {
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-1.5f, 0.f, 4.f));
-    model = glm::scale(model, glm::vec3(0.9f, 0.9f, 0.9f));
-    shader.setMat4("model", model);
-    statModels[5].Draw(shader);
+        // disableGrass is set during the shadow pass
+        if (!instance.castsShadow && programState->disableGrass)
+            continue;
+        Model &m = statModels[instance.model];
+        Shader &shader = shaders.Use(scene->models[instance.model].alphaTest ? (unsigned int) rg::SHADER_ALPHA_TEST : 0u);
+        m.Draw(shader, instance.transform, m.SelectLod(lod, instance.center, instance.radius, instance.scale));
     }
 }
 
-void DrawAxis(Shader &shader, const SimpleModel &axisSModel, const std::vector<glm::vec3> &axisColor, glm::mat4 projection)
+void DrawAxis(Shader &shader, const SimpleModel &axisSModel, const std::vector<glm::vec3> &axisColor)
 {
     // drawing axis
     glm::mat4 model = glm::mat4(1.0f);
     shader.use();
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", programState->camera->GetViewMatrix());
     for(int i=0; i<3; ++i)
     {
         model = glm::rotate(model, glm::radians(90.f), axisColor[i]);
@@ -727,81 +876,39 @@ void DrawImGuiInfoWindows()
     if(programState->camera == fps_camera || programState->isCVars)
         return;
 
-    if(mainModelState->mmPosition.x<=0.0 && mainModelState->mmPosition.x>=-4.0
-       && mainModelState->mmPosition.z>=0.0 && mainModelState->mmPosition.z<=4.0)
-    {
-        ImGui::Begin("Welcome Home!");
-        ImGui::SetWindowPos(ImVec2(programState->scaleWidth, programState->scaleHeight));
-        ImGui::Text("Hello traveler!\nUse your W-A-S-D keys to move around the map.\n"
-                    "You can go up and down with your SPACE and SHIFT keys.\n"
-                    "Also, you can rotate your camera around the air balloon using your mouse, for better views!\n"
-                    "Try to get closer to the structures around the area to find out more about them!\n");
-        ImGui::End();
-    }
-    else if(mainModelState->mmPosition.x<=4.0 && mainModelState->mmPosition.x>=-4.0
-            && mainModelState->mmPosition.z>=11.0 && mainModelState->mmPosition.z<=19.0)
-    {
-        ImGui::Begin("Christ the Redeemer");
-        ImGui::SetWindowPos(ImVec2(programState->scaleWidth, programState->scaleHeight));
-        ImGui::Text("This is statue of Jesus Christ located in Rio de Janeiro, Brazil.\n"
-                    "The statue is 30 meters high!\n"
-                    "The original design of the Christ the Redeemer statue was different to what we see today.\n"
-                    "It was intended for Christ to be holding a globe in one hand and a cross in the other,\nrather"
-                    " than two open arms.");
-        ImGui::End();
-    }
-    else if(mainModelState->mmPosition.x<=19.0 && mainModelState->mmPosition.x>=11.0
-            && mainModelState->mmPosition.z>=6.0 && mainModelState->mmPosition.z<=14.0)
-    {
-        ImGui::Begin("Leaning Tower of Pisa");
-        ImGui::SetWindowPos(ImVec2(programState->scaleWidth, programState->scaleHeight));
-        ImGui::Text("The Tower of Pisa is freestanding bell tower of Pisa Cathedral located in Pisa, Italy.\n"
-                    "The tower is 55m high!\n"
-                    "The leaning of the tower is due to both a wrong assumption and poor engineering, but still, it\n"
-                    "is a miracle of physics, because there is no good reason why the tower lasted for 800 years!");
-        ImGui::End();
-    }
-
-    else if(mainModelState->mmPosition.x<=-14.0 && mainModelState->mmPosition.x>=-26.0
-            && mainModelState->mmPosition.z>=-11.0 && mainModelState->mmPosition.z<=1.0)
-    {
-        ImGui::Begin("Big Ben");
-        ImGui::SetWindowPos(ImVec2(programState->scaleWidth, programState->scaleHeight));
-        ImGui::Text("Big Ben is the nickname for the Great Bell of the Elizabeth Tower located in London, England.\n"
-                    "The tower itself is 96m high!\n"
-                    "The name Big Ben does not refer to the clock or the tower, but to the bell inside the tower!\n"
-                    "Despite that, Big Ben became the nickname for the whole clock-tower.");
-        ImGui::End();
-    }
-    else if(mainModelState->mmPosition.x<=11.0 && mainModelState->mmPosition.x>=-1.0
-            && mainModelState->mmPosition.z>=-21.0 && mainModelState->mmPosition.z<=-9.0)
+    const rg::Scene::InfoRegion *region = scene->RegionAt(mainModelState->mmPosition);
+    if(region)
     {
-        ImGui::Begin("Statue of Liberty");
+        ImGui::Begin(region->title.c_str());
         ImGui::SetWindowPos(ImVec2(programState->scaleWidth, programState->scaleHeight));
-        ImGui::Text("The Statue of Liberty is a colossal copper statue, a gift from the people of France located\n"
-                    "in New York City, USA.\n"
-                    "The statue is 93m high!\n"
-                    "It was originally intended for Egypt and it would have called Egypt Carrying the Light to Asia,\n"
-                    "but the project was rejected due to its cost and the idea was recycled to be The Statue of Liberty.");
+        ImGui::TextUnformatted(region->text.c_str());
         ImGui::End();
     }
 }
 
-void DrawCVarAndAxis(GLFWwindow *window, Shader &shader, const SimpleModel &axisSModel, const std::vector<glm::vec3> &axisColor, glm::mat4 projection)
+void DrawCVarAndAxis(GLFWwindow *window, Shader &shader, const SimpleModel &axisSModel, const std::vector<glm::vec3> &axisColor)
 {
     if(programState->isCVars)
     {
-        DrawAxis(shader, axisSModel, axisColor, projection);
+        DrawAxis(shader, axisSModel, axisColor);
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
         ImGui::Begin("CVARS");
-        ImGui::SetWindowSize(ImVec2(450.f, 200.f));
+        ImGui::SetWindowSize(ImVec2(450.f, 320.f));
         if(ImGui::RadioButton("TPP Camera", programState->camera == tpp_camera))
             programState->camera = tpp_camera;
         else if(ImGui::RadioButton("FPS Camera", programState->camera == fps_camera))
             programState->camera = fps_camera;
 
         ImGui::DragFloat("Air Balloon speed", &mainModelState->mmSpeed, 0.1f, 0.1f, 2.f);
+        ImGui::DragFloat("LOD bias", &programState->lodBias, 0.1f, -2.f, 4.f);
+
+        // GL state changes of the last frame, the ones the tracker dropped as redundant next to the issued ones
+        const rg::GLState::Counters &glCalls = rg::GLState::Instance().LastFrame();
+        ImGui::Text("GL state calls: %zu issued, %zu elided", glCalls.Issued(), glCalls.Elided());
+        for(int kind = 0; kind < rg::GLState::KIND_COUNT; ++kind)
+            ImGui::Text("  %-15s %6zu issued %6zu elided", rg::GLState::KindName((rg::GLState::Kind) kind),
+                        glCalls.issued[kind], glCalls.elided[kind]);
 
         ImGui::End();
     }
@@ -811,36 +918,52 @@ void DrawCVarAndAxis(GLFWwindow *window, Shader &shader, const SimpleModel &axis
     }
 }
 
-void SetLightParameters(Shader &shader) {
-    shader.use();
-    shader.setVec3("viewPos", programState->camera->Position);
-    shader.setVec3("dirLight.direction", programState->dirLight);
-    shader.setVec3("dirLight.ambient", programState->dirAmbient);
-    shader.setVec3("dirLight.diffuse", programState->dirDiffuse);
-    shader.setVec3("dirLight.specular", programState->dirSpecular);
-    shader.setFloat("material.shininess", 32.f);
+void UpdateFrameUniforms(rg::UniformBuffer<rg::CameraBlock> &camera, rg::UniformBuffer<rg::LightsBlock> &lights,
+                         const glm::mat4 &projection)
+{
+    rg::CameraBlock cameraBlock;
+    cameraBlock.view = programState->camera->GetViewMatrix();
+    cameraBlock.projection = projection;
+    cameraBlock.viewPos = programState->camera->Position;
+    camera.Upload(cameraBlock);
+
+    // kept between frames, the spot light is only updated and drawn with the third person camera
+    static rg::LightsBlock lightsBlock;
+    lightsBlock.dirLight.direction = programState->dirLight;
+    lightsBlock.dirLight.ambient = programState->dirAmbient;
+    lightsBlock.dirLight.diffuse = programState->dirDiffuse;
+    lightsBlock.dirLight.specular = programState->dirSpecular;
 
     if (programState->camera == tpp_camera)
     {
-        shader.setVec3("spotLight.position", mainModelState->mmPosition);
-        shader.setVec3("spotLight.direction", programState->camera->Front);
-        shader.setVec3("spotLight.ambient", 0.1f, 0.0f, 0.0f);
-        shader.setVec3("spotLight.diffuse", 1.0f, 0.0f, 0.2f);
-        shader.setVec3("spotLight.specular", 1.0f, .0f, .0f);
-        shader.setFloat("spotLight.constant", 1.0f);
-        shader.setFloat("spotLight.linear", 0.09f);
-        shader.setFloat("spotLight.quadratic", 0.05);
-        shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(6.5f)));
-        shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(10.5f)));
+        rg::SpotLightBlock &spot = lightsBlock.spotLight;
+        spot.position = mainModelState->mmPosition;
+        spot.direction = programState->camera->Front;
+        spot.ambient = glm::vec3(0.1f, 0.0f, 0.0f);
+        spot.diffuse = glm::vec3(1.0f, 0.0f, 0.2f);
+        spot.specular = glm::vec3(1.0f, .0f, .0f);
+        spot.constant = 1.0f;
+        spot.linear = 0.09f;
+        spot.quadratic = 0.05f;
+        spot.cutOff = glm::cos(glm::radians(6.5f));
+        spot.outerCutOff = glm::cos(glm::radians(10.5f));
     }
 
-    shader.setVec3("pointLight.position", programState->pointLight);
-    shader.setVec3("pointLight.ambient", 0.98f, 1.f, 0.2f);
-    shader.setVec3("pointLight.diffuse", 0.98f, 1.f, 0.2f);
-    shader.setVec3("pointLight.specular", 0.98f, 1.0f, 0.2f);
-    shader.setFloat("pointLight.constant", 1.0f);
-    shader.setFloat("pointLight.linear", 0.09);
-    shader.setFloat("pointLight.quadratic", 0.032);
+    rg::PointLightBlock &point = lightsBlock.pointLight;
+    point.position = programState->pointLight;
+    point.ambient = glm::vec3(0.98f, 1.f, 0.2f);
+    point.diffuse = glm::vec3(0.98f, 1.f, 0.2f);
+    point.specular = glm::vec3(0.98f, 1.0f, 0.2f);
+    point.constant = 1.0f;
+    point.linear = 0.09f;
+    point.quadratic = 0.032f;
+    lights.Upload(lightsBlock, 0);
+
+    // grass has no additional tex maps, its sun is plain white
+    rg::LightsBlock grassLights = lightsBlock;
+    grassLights.dirLight.ambient = glm::vec3(1.f, 1.f, 1.f);
+    grassLights.dirLight.diffuse = glm::vec3(1.f, 1.f, 1.f);
+    lights.Upload(grassLights, 1);
 }
 
 void SaveStateSettings(const std::string& path)
@@ -868,18 +991,28 @@ void LoadStateSettings(const std::string& path)
     }
 }
 
-void renderScene(Shader &shader, SimpleModel &grassPlane, SimpleModel &grass, std::vector<glm::vec3> &grassPos,
-                 std::vector<Model> &statModels, Model &hot_air_balloon, glm::mat4 projection,
+void renderScene(rg::ShaderVariants &shaders, SimpleModel &grassPlane, SimpleModel &grass, std::vector<glm::vec3> &grassPos,
+                 std::vector<Model> &statModels, Model &hot_air_balloon, const rg::UniformBuffer<rg::LightsBlock> &lights,
                  GLFWwindow *window)
 {
-    // drawing grass plane model
-    DrawGrassGround(shader, grassPlane, grass, grassPos, projection);
-    // set all lights parameters
-    SetLightParameters(shader);
+    // drawing grass plane model, the lights and the camera come from the uniform blocks
+    DrawGrassGround(shaders, grassPlane, grass, grassPos, lights);
     // drawing other static models
-    DrawAllStationeryModels(statModels, shader, projection);
+    DrawAllStationeryModels(statModels, shaders);
     // drawing balloon model
-    DrawAirBalloon(shader, hot_air_balloon, projection);
+    DrawAirBalloon(shaders, hot_air_balloon);
     // idle "animation"
     AirBalloonIdleEvent(window);
-}
\ No newline at end of file
+}
+
+void DrawLoadingOverlay(const rg::ModelQueue &models, size_t pendingTextures)
+{
+    ImGui::SetNextWindowPos(ImVec2(10.0f, SCR_HEIGHT - 10.0f), ImGuiCond_Always, ImVec2(0.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoInputs);
+    char label[32];
+    std::snprintf(label, sizeof(label), "%zu / %zu models", models.UploadedCount(), models.Count());
+    ImGui::ProgressBar(models.Count() ? (float) models.UploadedCount() / models.Count() : 1.0f, ImVec2(200.0f, 0.0f), label);
+    ImGui::Text("%zu textures streaming", pendingTextures);
+    ImGui::End();
+}
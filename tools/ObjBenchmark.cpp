@@ -0,0 +1,117 @@
+// Compares the import time of rg::ObjLoader with Assimp on the same OBJ files.
+// usage: ObjBenchmark [runs] file.obj...   (defaults to the landmark models and 5 runs)
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <rg/ObjLoader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Result {
+    double milliseconds = 0.0;
+    size_t meshes = 0, vertices = 0, triangles = 0;
+};
+
+template<typename F>
+static double medianMilliseconds(int runs, F function)
+{
+    std::vector<double> times;
+    for (int i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// same flags as Model::loadModel
+static Result importAssimp(const std::string &path, int runs)
+{
+    Result result;
+    result.milliseconds = medianMilliseconds(runs, [&] {
+        Assimp::Importer importer;
+        const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals
+                                                       | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        if (!scene)
+            return;
+        result = Result();
+        result.meshes = scene->mNumMeshes;
+        for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+        {
+            result.vertices += scene->mMeshes[i]->mNumVertices;
+            result.triangles += scene->mMeshes[i]->mNumFaces;
+        }
+    });
+    return result;
+}
+
+static Result importNative(const std::string &path, int runs)
+{
+    Result result;
+    result.milliseconds = medianMilliseconds(runs, [&] {
+        rg::ObjLoader loader;
+        if (!loader.Load(path))
+            return;
+        result = Result();
+        result.meshes = loader.meshes.size();
+        for (const rg::ObjMesh &mesh : loader.meshes)
+        {
+            result.vertices += mesh.vertices.size();
+            result.triangles += mesh.indices.size() / 3;
+        }
+    });
+    return result;
+}
+
+static void print(const char *name, const Result &result)
+{
+    std::cout << "  " << std::left << std::setw(10) << name << std::right << std::setw(9) << result.milliseconds << " ms, "
+              << result.meshes << " meshes, " << result.vertices << " vertices, " << result.triangles << " triangles" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 5;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        char *end = nullptr;
+        long value = std::strtol(argv[i], &end, 10);
+        if (i == 1 && *end == '\0' && value > 0)
+            runs = (int) value;
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+        paths = {"resources/objects/big_ben/10059_big_ben_v2_max2011_it1.obj",
+                 "resources/objects/liberty_statue/LibertStatue.obj",
+                 "resources/objects/pisa_tower/10076_pisa_tower_v1_max2009_it0.obj",
+                 "resources/objects/tree/Tree.obj",
+                 "resources/objects/tree_house/10783_TreeHouse_v7_LOD3.obj"};
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "median of " << runs << " runs, " << rg::ThreadPool::Shared().Size() << " worker threads" << std::endl;
+    double nativeTotal = 0.0, assimpTotal = 0.0;
+    for (const std::string &path : paths)
+    {
+        std::cout << path << std::endl;
+        Result native = importNative(path, runs);
+        Result assimp = importAssimp(path, runs);
+        print("ObjLoader", native);
+        print("Assimp", assimp);
+        nativeTotal += native.milliseconds;
+        assimpTotal += assimp.milliseconds;
+    }
+    std::cout << "total: ObjLoader " << nativeTotal << " ms, Assimp " << assimpTotal << " ms, speedup "
+              << (nativeTotal > 0.0 ? assimpTotal / nativeTotal : 0.0) << "x" << std::endl;
+    return 0;
+}
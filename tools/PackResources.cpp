@@ -0,0 +1,68 @@
+// Packs every file under resources/ into one rg::ResourcePack.
+// usage: PackResources [root] [output]   (defaults to the project root and <root>/resources.pack)
+// The cooked meshes and compressed textures in resources/cache are packed as well, run the program once
+// before packing so the cache is filled.
+#include <rg/ResourcePack.h>
+
+#include "root_directory.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static bool endsWith(const std::string &s, const std::string &suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// root relative paths of the regular files below directory, temporary files of the caches are left out
+static void collect(const std::string &root, const std::string &directory, std::vector<std::string> &paths)
+{
+    DIR *dir = opendir((root + "/" + directory).c_str());
+    if (!dir)
+        return;
+    while (dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == ".." || endsWith(name, ".tmp"))
+            continue;
+        std::string path = directory + "/" + name;
+        // program binaries only load on the driver that wrote them
+        if (path == "resources/cache/programs")
+            continue;
+        struct stat st;
+        if (stat((root + "/" + path).c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            collect(root, path, paths);
+        else if (S_ISREG(st.st_mode))
+            paths.push_back(path);
+    }
+    closedir(dir);
+}
+
+int main(int argc, char **argv)
+{
+    std::string root = argc > 1 ? argv[1] : logl_root;
+    std::string output = argc > 2 ? argv[2] : root + "/resources.pack";
+
+    std::vector<std::string> paths;
+    collect(root, "resources", paths);
+    // sorted, so the pack only changes when the files do
+    std::sort(paths.begin(), paths.end());
+    if (paths.empty())
+    {
+        std::cout << "PackResources: nothing to pack in " << root << "/resources" << std::endl;
+        return 1;
+    }
+    if (!rg::ResourcePack::Write(output, root, paths))
+        return 1;
+
+    rg::ResourcePack pack(output);
+    std::cout << "PackResources: " << pack.Count() << " files, " << pack.SizeInBytes() / 1024 << " KB in " << output << std::endl;
+    return pack.Count() == paths.size() ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// Measures the CPU time the uniform updates of one frame take, with a glGetUniformLocation and a std::string
+// per call (the way Shader used to set them), with the location table and handles of Shader, and with the
+// camera and lights in uniform blocks uploaded once per frame (what main.cpp does now). The lights are block
+// members in the current shaders, so the first two only pay for the lookups and calls the driver then ignores.
+// usage: UniformBenchmark [frames]   (defaults to 200, run it from the project root)
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader.h>
+#include <rg/UniformBuffer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// the light uniforms main.cpp sets per SetLightParameters call, with the third person camera
+static const char *VEC3_UNIFORMS[] = {
+    "viewPos", "dirLight.direction", "dirLight.ambient", "dirLight.diffuse", "dirLight.specular",
+    "spotLight.position", "spotLight.direction", "spotLight.ambient", "spotLight.diffuse", "spotLight.specular",
+    "pointLight.position", "pointLight.ambient", "pointLight.diffuse", "pointLight.specular"};
+static const char *FLOAT_UNIFORMS[] = {
+    "material.shininess", "spotLight.constant", "spotLight.linear", "spotLight.quadratic", "spotLight.cutOff",
+    "spotLight.outerCutOff", "pointLight.constant", "pointLight.linear", "pointLight.quadratic"};
+// SetLightParameters runs twice per pass, for the shadow and the main pass
+static const int LIGHT_CALLS_PER_FRAME = 4;
+static const int GRASS_BLADES = 1000;
+
+static GLint legacyLocation(const Shader &shader, const std::string &name)
+{
+    return glGetUniformLocation(shader.ID, name.c_str());
+}
+
+static void legacyFrame(const Shader &shader, const std::vector<glm::mat4> &blades)
+{
+    glm::vec3 value(0.5f);
+    for(int call = 0; call < LIGHT_CALLS_PER_FRAME; ++call)
+    {
+        for(const char *name : VEC3_UNIFORMS)
+            glUniform3fv(legacyLocation(shader, name), 1, &value[0]);
+        for(const char *name : FLOAT_UNIFORMS)
+            glUniform1f(legacyLocation(shader, name), 1.0f);
+    }
+    // model, projection and view for every blade
+    for(const glm::mat4 &blade : blades)
+    {
+        glUniformMatrix4fv(legacyLocation(shader, "model"), 1, GL_FALSE, &blade[0][0]);
+        glUniformMatrix4fv(legacyLocation(shader, "projection"), 1, GL_FALSE, &blade[0][0]);
+        glUniformMatrix4fv(legacyLocation(shader, "view"), 1, GL_FALSE, &blade[0][0]);
+    }
+}
+
+static void tableFrame(const Shader &shader, const std::vector<glm::mat4> &blades)
+{
+    glm::vec3 value(0.5f);
+    for(int call = 0; call < LIGHT_CALLS_PER_FRAME; ++call)
+    {
+        for(const char *name : VEC3_UNIFORMS)
+            shader.setVec3(name, value);
+        for(const char *name : FLOAT_UNIFORMS)
+            shader.setFloat(name, 1.0f);
+    }
+    shader.setMat4("projection", blades[0]);
+    shader.setMat4("view", blades[0]);
+    Shader::Uniform model = shader.GetUniform("model");
+    for(const glm::mat4 &blade : blades)
+        shader.setMat4(model, blade);
+}
+
+static void blockFrame(const Shader &shader, const std::vector<glm::mat4> &blades,
+                       rg::UniformBuffer<rg::CameraBlock> &camera, rg::UniformBuffer<rg::LightsBlock> &lights)
+{
+    camera.Upload(rg::CameraBlock());
+    lights.Upload(rg::LightsBlock(), 0);
+    lights.Upload(rg::LightsBlock(), 1);
+    Shader::Uniform model = shader.GetUniform("model");
+    for(const glm::mat4 &blade : blades)
+        shader.setMat4(model, blade);
+}
+
+template<typename F>
+static double medianMicroseconds(int frames, F frame)
+{
+    std::vector<double> times;
+    for(int i = 0; i < frames; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        frame();
+        glFinish();
+        times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    GLFWwindow *window = glfwCreateWindow(64, 64, "UniformBenchmark", nullptr, nullptr);
+    if(window != nullptr)
+        glfwMakeContextCurrent(window);
+    if(window == nullptr || !gladLoadGLLoader((GLADloadproc) glfwGetProcAddress))
+    {
+        std::cout << "UniformBenchmark: no OpenGL 3.3 context" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+
+    {
+        Shader shader("resources/shaders/modelshader.vs", "resources/shaders/modelshader.fs");
+        shader.use();
+        rg::UniformBuffer<rg::CameraBlock> camera(rg::CAMERA_BLOCK_BINDING);
+        rg::UniformBuffer<rg::LightsBlock> lights(rg::LIGHTS_BLOCK_BINDING, 2);
+        rg::UniformBuffer<rg::CameraBlock>::Attach(shader, "Camera", rg::CAMERA_BLOCK_BINDING);
+        rg::UniformBuffer<rg::LightsBlock>::Attach(shader, "Lights", rg::LIGHTS_BLOCK_BINDING);
+        std::vector<glm::mat4> blades;
+        for(int i = 0; i < GRASS_BLADES; ++i)
+            blades.push_back(glm::translate(glm::mat4(1.0f), glm::vec3((float) i, 0.0f, 0.0f)));
+
+        // one untimed round each, so neither pays for first use
+        legacyFrame(shader, blades);
+        tableFrame(shader, blades);
+        blockFrame(shader, blades, camera, lights);
+        double legacy = medianMicroseconds(frames, [&] { legacyFrame(shader, blades); });
+        double table = medianMicroseconds(frames, [&] { tableFrame(shader, blades); });
+        double blocks = medianMicroseconds(frames, [&] { blockFrame(shader, blades, camera, lights); });
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "uniform updates per frame, median of " << frames << " frames:" << std::endl;
+        std::cout << "  glGetUniformLocation per call " << std::setw(9) << legacy << " us" << std::endl;
+        std::cout << "  location table and handles    " << std::setw(9) << table << " us" << std::endl;
+        std::cout << "  uniform blocks and handles    " << std::setw(9) << blocks << " us" << std::endl;
+        std::cout << "  saved per frame               " << std::setw(9) << legacy - blocks << " us" << std::endl;
+        camera.Destroy();
+        lights.Destroy();
+    }
+    glfwTerminate();
+    return 0;
+}